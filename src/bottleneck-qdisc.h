@@ -0,0 +1,156 @@
+#ifndef BOTTLENECK_QDISC_H
+#define BOTTLENECK_QDISC_H
+
+#include "ns3/abort.h"
+#include "ns3/data-rate.h"
+#include "ns3/net-device.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/queue-disc.h"
+#include "ns3/queue-size.h"
+#include "ns3/queue.h"
+#include "ns3/string.h"
+#include "ns3/traffic-control-helper.h"
+#include "ns3/traffic-control-layer.h"
+
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+// --- DISCIPLINA DE COLA DEL CUELLO DE BOTELLA (--qdisc) ---
+// Formato: "<nombre>[Atributo=valor|Atributo=valor...]", con los nombres cortos de Linux
+// o un TypeId completo de ns-3. Los atributos son los del QueueDisc correspondiente, p. ej.
+//   fq_codel[Target=5ms|Interval=100ms|MaxSize=10240p|Flows=1024]
+//   codel[Target=5ms|Interval=100ms|MaxSize=1000p]
+//   pie[QueueDelayReference=15ms|Tupdate=15ms|A=0.125|B=1.25|MaxSize=1000p]
+//   red[MinTh=5|MaxTh=15|MaxSize=25p|ARED=true]
+//   pfifo[MaxSize=1000p]
+// "none" quita la disciplina que instala ns-3 por defecto, de modo que los paquetes van
+// directamente a la cola FIFO del dispositivo; "default" la deja, pero con la cola del
+// dispositivo reducida como las demás, para compararla con ellas en igualdad de condiciones.
+struct QdiscSpec
+{
+    std::string name;
+    std::string typeId; // Vacío con "none" y "default"
+    bool keep = false;  // "default": se conserva la disciplina que instala ns-3
+    std::vector<std::pair<std::string, std::string>> attributes;
+};
+
+inline QdiscSpec
+ParseQdiscSpec(const std::string& text)
+{
+    static const std::map<std::string, std::string> typeIds = {
+        {"fq_codel", "ns3::FqCoDelQueueDisc"},
+        {"codel", "ns3::CoDelQueueDisc"},
+        {"pie", "ns3::PieQueueDisc"},
+        {"red", "ns3::RedQueueDisc"},
+        {"pfifo", "ns3::FifoQueueDisc"},
+        {"none", ""},
+        {"default", ""},
+    };
+    QdiscSpec spec;
+    size_t open = text.find('[');
+    spec.name = text.substr(0, open);
+    spec.keep = spec.name == "default";
+    auto known = typeIds.find(spec.name);
+    if (known != typeIds.end())
+    {
+        spec.typeId = known->second;
+    }
+    else
+    {
+        NS_ABORT_MSG_UNLESS(spec.name.rfind("ns3::", 0) == 0,
+                            "--qdisc: disciplina desconocida '" << spec.name << "' (fq_codel, codel, pie, red, pfifo, none o default)");
+        spec.typeId = spec.name;
+    }
+    if (open == std::string::npos)
+    {
+        return spec;
+    }
+    NS_ABORT_MSG_UNLESS(text.back() == ']', "--qdisc: falta ']' en '" << text << "'");
+    NS_ABORT_MSG_IF(spec.typeId.empty(), "--qdisc: '" << spec.name << "' no admite atributos");
+    std::istringstream in(text.substr(open + 1, text.size() - open - 2));
+    std::string item;
+    while (std::getline(in, item, '|'))
+    {
+        size_t eq = item.find('=');
+        NS_ABORT_MSG_IF(eq == std::string::npos || eq == 0, "--qdisc: se esperaba 'Atributo=valor' en '" << item << "'");
+        spec.attributes.emplace_back(item.substr(0, eq), item.substr(eq + 1));
+    }
+    return spec;
+}
+
+/**
+ * Sustituye la disciplina de cola raíz del dispositivo de salida del cuello de botella.
+ *
+ * Ipv4AddressHelper instala por defecto un FqCoDel en cada dispositivo con control de flujo,
+ * pero con la cola del dispositivo de 100 paquetes casi toda la cola se forma en el
+ * dispositivo y la disciplina apenas actúa. Por eso la cola del dispositivo se reduce a
+ * 'deviceQueueSize' (el papel de BQL en Linux) y la cola se forma en la disciplina.
+ *
+ * A RED se le pasan la tasa y el retardo del enlace si no se indican en la especificación.
+ * Devuelve la disciplina instalada (nula con "none"; con "default", la que ya había).
+ */
+inline Ptr<QueueDisc>
+InstallBottleneckQdisc(Ptr<NetDevice> device,
+                       const QdiscSpec& spec,
+                       const std::string& deviceQueueSize,
+                       DataRate linkRate,
+                       Time linkDelay)
+{
+    Ptr<TrafficControlLayer> tc = device->GetNode()->GetObject<TrafficControlLayer>();
+    if (tc && tc->GetRootQueueDiscOnDevice(device) && !spec.keep)
+    {
+        TrafficControlHelper().Uninstall(device);
+    }
+    if (!deviceQueueSize.empty())
+    {
+        PointerValue queue;
+        device->GetAttribute("TxQueue", queue);
+        queue.Get<Queue<Packet>>()->SetMaxSize(QueueSize(deviceQueueSize));
+    }
+    if (spec.typeId.empty())
+    {
+        return spec.keep && tc ? tc->GetRootQueueDiscOnDevice(device) : nullptr;
+    }
+
+    TrafficControlHelper tch;
+    tch.SetRootQueueDisc(spec.typeId);
+    Ptr<QueueDisc> qdisc = tch.Install(device).Get(0);
+    auto given = [&spec](const std::string& name) {
+        for (const auto& [attribute, value] : spec.attributes)
+        {
+            if (attribute == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+    if (spec.typeId == "ns3::RedQueueDisc")
+    {
+        if (!given("LinkBandwidth"))
+        {
+            qdisc->SetAttribute("LinkBandwidth", DataRateValue(linkRate));
+        }
+        if (!given("LinkDelay"))
+        {
+            qdisc->SetAttribute("LinkDelay", TimeValue(linkDelay));
+        }
+    }
+    for (const auto& [attribute, value] : spec.attributes)
+    {
+        NS_ABORT_MSG_UNLESS(qdisc->SetAttributeFailSafe(attribute, StringValue(value)),
+                            "--qdisc: atributo o valor no válido para " << spec.typeId << ": " << attribute << "=" << value);
+    }
+    return qdisc;
+}
+
+} // namespace ns3
+
+#endif // BOTTLENECK_QDISC_H
@@ -0,0 +1,606 @@
+#ifndef DASH_STREAMING_H
+#define DASH_STREAMING_H
+
+#include "ns3/abort.h"
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/data-rate.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/string.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/uinteger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+// Escalera de calidades "200kb/s,500kb/s,800kb/s" -> bps en orden ascendente
+inline std::vector<uint64_t>
+ParseBitrateLadder(const std::string& text)
+{
+    std::vector<uint64_t> ladder;
+    std::istringstream in(text);
+    for (std::string item; std::getline(in, item, ',');)
+    {
+        ladder.push_back(DataRate(item).GetBitRate());
+    }
+    NS_ABORT_MSG_IF(ladder.empty(), "Escalera de bitrates vacía: '" << text << "'");
+    std::sort(ladder.begin(), ladder.end());
+    return ladder;
+}
+
+/**
+ * Servidor de vídeo por segmentos (estilo DASH).
+ *
+ * Escucha conexiones TCP en 'Port'. Cada petición es un entero de 4 bytes con el índice de
+ * calidad en la escalera 'BitrateLadder'; el servidor responde con un segmento de
+ * SegmentDuration * bitrate bytes, troceado en paquetes de 'PacketSize' a medida que el
+ * buffer de envío del socket lo admite. Las peticiones de una conexión se atienden en orden.
+ */
+class DashServer : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::DashServer")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<DashServer>()
+                .AddAttribute("Port",
+                              "Puerto TCP en el que se aceptan las conexiones de los clientes",
+                              UintegerValue(80),
+                              MakeUintegerAccessor(&DashServer::m_port),
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("BitrateLadder",
+                              "Bitrates de las calidades disponibles, separados por comas",
+                              StringValue("200kb/s,500kb/s,800kb/s"),
+                              MakeStringAccessor(&DashServer::m_ladderText),
+                              MakeStringChecker())
+                .AddAttribute("SegmentDuration",
+                              "Duración de contenido de cada segmento",
+                              TimeValue(Seconds(2)),
+                              MakeTimeAccessor(&DashServer::m_segmentDuration),
+                              MakeTimeChecker())
+                .AddAttribute("PacketSize",
+                              "Tamaño de los paquetes en que se trocea cada segmento",
+                              UintegerValue(512),
+                              MakeUintegerAccessor(&DashServer::m_pktSize),
+                              MakeUintegerChecker<uint32_t>(1));
+        return tid;
+    }
+
+    DashServer()
+        : m_port(80),
+          m_pktSize(512)
+    {
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_socket = nullptr;
+        m_connections.clear();
+        Application::DoDispose();
+    }
+
+  private:
+    // Estado de una conexión aceptada
+    struct Connection
+    {
+        uint64_t pendingBytes = 0;       // Bytes de segmentos pedidos que faltan por enviar
+        std::vector<uint8_t> request;    // Bytes de una petición recibida a medias
+    };
+
+    void StartApplication() override
+    {
+        m_ladder = ParseBitrateLadder(m_ladderText);
+        m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_port));
+        m_socket->Listen();
+        m_socket->SetAcceptCallback(MakeNullCallback<bool, Ptr<Socket>, const Address&>(),
+                                    MakeCallback(&DashServer::Accept, this));
+    }
+
+    void StopApplication() override
+    {
+        if (m_socket)
+        {
+            m_socket->Close();
+        }
+        for (auto& [socket, connection] : m_connections)
+        {
+            socket->Close();
+        }
+        m_connections.clear();
+    }
+
+    void Accept(Ptr<Socket> socket, const Address&)
+    {
+        m_connections[socket] = Connection();
+        socket->SetRecvCallback(MakeCallback(&DashServer::HandleRequest, this));
+        socket->SetSendCallback(MakeCallback(&DashServer::SendPending, this));
+    }
+
+    void HandleRequest(Ptr<Socket> socket)
+    {
+        auto it = m_connections.find(socket);
+        if (it == m_connections.end())
+        {
+            return;
+        }
+        Connection& c = it->second;
+        while (Ptr<Packet> packet = socket->Recv())
+        {
+            size_t old = c.request.size();
+            c.request.resize(old + packet->GetSize());
+            packet->CopyData(c.request.data() + old, packet->GetSize());
+        }
+        // TCP puede juntar o partir peticiones: se consumen de 4 en 4 bytes
+        size_t used = 0;
+        for (; used + 4 <= c.request.size(); used += 4)
+        {
+            uint32_t quality;
+            std::memcpy(&quality, c.request.data() + used, 4);
+            quality = std::min<uint32_t>(quality, m_ladder.size() - 1);
+            c.pendingBytes += static_cast<uint64_t>(m_ladder[quality] * m_segmentDuration.GetSeconds() / 8);
+        }
+        c.request.erase(c.request.begin(), c.request.begin() + used);
+        SendPending(socket, socket->GetTxAvailable());
+    }
+
+    void SendPending(Ptr<Socket> socket, uint32_t)
+    {
+        auto it = m_connections.find(socket);
+        if (it == m_connections.end())
+        {
+            return;
+        }
+        Connection& c = it->second;
+        while (c.pendingBytes > 0 && socket->GetTxAvailable() > 0)
+        {
+            uint32_t size = std::min<uint64_t>({m_pktSize, c.pendingBytes, socket->GetTxAvailable()});
+            if (socket->Send(Create<Packet>(size)) < 0)
+            {
+                break;
+            }
+            c.pendingBytes -= size;
+        }
+    }
+
+    uint16_t m_port;
+    std::string m_ladderText;
+    std::vector<uint64_t> m_ladder;
+    Time m_segmentDuration;
+    uint32_t m_pktSize;
+    Ptr<Socket> m_socket;
+    std::map<Ptr<Socket>, Connection> m_connections;
+};
+
+// Contadores de reproducción de un cliente, sumables entre clientes
+struct DashClientStats
+{
+    uint32_t sessions = 0;        // Sesiones de visionado empezadas
+    uint32_t started = 0;         // Sesiones que llegaron a empezar la reproducción
+    uint32_t stalls = 0;          // Paradas por buffer vacío
+    double startupDelaySum = 0;   // Suma de los retardos de arranque (s)
+    double playSeconds = 0;       // Tiempo reproduciendo
+    double stallSeconds = 0;      // Tiempo parado con el buffer vacío tras arrancar
+    double mediaSeconds = 0;      // Contenido descargado (s)
+    double mediaBits = 0;         // Suma de bitrate * duración de los segmentos descargados
+
+    void Add(const DashClientStats& o)
+    {
+        sessions += o.sessions;
+        started += o.started;
+        stalls += o.stalls;
+        startupDelaySum += o.startupDelaySum;
+        playSeconds += o.playSeconds;
+        stallSeconds += o.stallSeconds;
+        mediaSeconds += o.mediaSeconds;
+        mediaBits += o.mediaBits;
+    }
+
+    double StartupDelay() const
+    {
+        return started > 0 ? startupDelaySum / started : 0;
+    }
+
+    // Fracción del tiempo de visionado (tras el arranque) que el vídeo estuvo parado
+    double RebufferRatio() const
+    {
+        return playSeconds + stallSeconds > 0 ? stallSeconds / (playSeconds + stallSeconds) : 0;
+    }
+
+    double AverageBitrateKbps() const
+    {
+        return mediaSeconds > 0 ? mediaBits / mediaSeconds / 1000 : 0;
+    }
+};
+
+/**
+ * Cliente de vídeo por segmentos con adaptación de calidad (ABR).
+ *
+ * Reproduce el patrón de visionado del modelo on/off: tras un periodo 'OffTime' empieza una
+ * sesión que dura 'OnTime'. Durante la sesión pide segmentos uno a uno por una conexión TCP
+ * con el servidor mientras el buffer no supere 'MaxBuffer', y reproduce en cuanto tiene
+ * 'StartupSegments' segmentos. Si el buffer se vacía, el vídeo se para hasta tener de nuevo
+ * un segmento. La calidad de cada segmento la elige 'Algorithm':
+ *  - "throughput": el mayor bitrate por debajo de 0.9 veces la media armónica del caudal
+ *    medido en los últimos 5 segmentos.
+ *  - "buffer": BBA-0 (Huang et al.): la calidad mínima con el buffer por debajo de una
+ *    reserva del 20% de MaxBuffer, la máxima por encima del 80% y lineal entre medias.
+ * 'MaxQuality' limita la calidad a la del dispositivo del espectador.
+ *
+ * El socket se enlaza a 'LocalPort' para que, en los nodos de abonado agregados, cada
+ * sesión se distinga por el puerto de destino como con los PacketSink.
+ */
+class DashClient : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::DashClient")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<DashClient>()
+                .AddAttribute("Remote",
+                              "Dirección y puerto del DashServer",
+                              AddressValue(),
+                              MakeAddressAccessor(&DashClient::m_remote),
+                              MakeAddressChecker())
+                .AddAttribute("LocalPort",
+                              "Puerto local del socket (0 = efímero)",
+                              UintegerValue(0),
+                              MakeUintegerAccessor(&DashClient::m_localPort),
+                              MakeUintegerChecker<uint16_t>())
+                .AddAttribute("BitrateLadder",
+                              "Bitrates de las calidades disponibles (la misma escalera que el servidor)",
+                              StringValue("200kb/s,500kb/s,800kb/s"),
+                              MakeStringAccessor(&DashClient::m_ladderText),
+                              MakeStringChecker())
+                .AddAttribute("SegmentDuration",
+                              "Duración de contenido de cada segmento",
+                              TimeValue(Seconds(2)),
+                              MakeTimeAccessor(&DashClient::m_segmentDuration),
+                              MakeTimeChecker())
+                .AddAttribute("MaxQuality",
+                              "Bitrate máximo que puede pedir el cliente",
+                              DataRateValue(DataRate("1Gb/s")),
+                              MakeDataRateAccessor(&DashClient::m_maxRate),
+                              MakeDataRateChecker())
+                .AddAttribute("Algorithm",
+                              "Algoritmo de adaptación: 'buffer' o 'throughput'",
+                              StringValue("buffer"),
+                              MakeStringAccessor(&DashClient::m_algorithm),
+                              MakeStringChecker())
+                .AddAttribute("MaxBuffer",
+                              "Contenido máximo en el buffer de reproducción",
+                              TimeValue(Seconds(30)),
+                              MakeTimeAccessor(&DashClient::m_maxBuffer),
+                              MakeTimeChecker())
+                .AddAttribute("StartupSegments",
+                              "Segmentos en el buffer necesarios para empezar a reproducir",
+                              UintegerValue(1),
+                              MakeUintegerAccessor(&DashClient::m_startupSegments),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("OnTime",
+                              "Variable aleatoria para la duración de las sesiones de visionado (s)",
+                              StringValue("ns3::ConstantRandomVariable[Constant=1e9]"),
+                              MakePointerAccessor(&DashClient::m_onTime),
+                              MakePointerChecker<RandomVariableStream>())
+                .AddAttribute("OffTime",
+                              "Variable aleatoria para el tiempo entre sesiones de visionado (s)",
+                              StringValue("ns3::ConstantRandomVariable[Constant=0]"),
+                              MakePointerAccessor(&DashClient::m_offTime),
+                              MakePointerChecker<RandomVariableStream>());
+        return tid;
+    }
+
+    DashClient()
+        : m_localPort(0),
+          m_startupSegments(1)
+    {
+    }
+
+    const DashClientStats& GetStats() const
+    {
+        return m_stats;
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_socket = nullptr;
+        m_onTime = nullptr;
+        m_offTime = nullptr;
+        Application::DoDispose();
+    }
+
+  private:
+    // Segmento pedido al servidor
+    struct SegmentRequest
+    {
+        uint32_t session; // m_session al pedirlo
+        uint32_t quality;
+        uint64_t bytes;
+        Time requestTime;
+    };
+
+    void StartApplication() override
+    {
+        m_ladder = ParseBitrateLadder(m_ladderText);
+        m_topQuality = 0;
+        while (m_topQuality + 1 < m_ladder.size() && m_ladder[m_topQuality + 1] <= m_maxRate.GetBitRate())
+        {
+            ++m_topQuality;
+        }
+        m_socket = Socket::CreateSocket(GetNode(), TcpSocketFactory::GetTypeId());
+        m_socket->Bind(InetSocketAddress(Ipv4Address::GetAny(), m_localPort));
+        m_socket->SetRecvCallback(MakeCallback(&DashClient::HandleRead, this));
+        m_socket->SetConnectCallback(MakeCallback(&DashClient::ConnectionSucceeded, this),
+                                     MakeCallback(&DashClient::ConnectionFailed, this));
+        m_socket->Connect(m_remote);
+    }
+
+    void StopApplication() override
+    {
+        EndSession(false);
+        Simulator::Cancel(m_sessionEvent);
+        if (m_socket)
+        {
+            m_socket->Close();
+        }
+    }
+
+    void ConnectionSucceeded(Ptr<Socket>)
+    {
+        // Igual que OnOffApplication: se empieza en un periodo off
+        m_sessionEvent = Simulator::Schedule(Seconds(m_offTime->GetValue()), &DashClient::BeginSession, this);
+    }
+
+    void ConnectionFailed(Ptr<Socket>)
+    {
+        NS_FATAL_ERROR("DashClient: no se pudo conectar con el servidor");
+    }
+
+    void BeginSession()
+    {
+        ++m_session;
+        m_active = true;
+        m_playing = false;
+        m_stalled = false;
+        m_downloading = false; // Lo que quede de la sesión anterior se descarta al llegar
+        m_buffer = 0;
+        m_bufferAt = Simulator::Now();
+        m_sessionStart = Simulator::Now();
+        m_throughput.clear();
+        ++m_stats.sessions;
+        m_sessionEvent = Simulator::Schedule(Seconds(m_onTime->GetValue()), &DashClient::EndSession, this, true);
+        RequestNext();
+    }
+
+    // Cierra la sesión de visionado en curso y, si 'next', programa la siguiente tras un periodo off
+    void EndSession(bool next)
+    {
+        if (!m_active)
+        {
+            return;
+        }
+        Time now = Simulator::Now();
+        if (m_playing)
+        {
+            m_stats.playSeconds += (now - m_playStart).GetSeconds();
+        }
+        if (m_stalled)
+        {
+            m_stats.stallSeconds += (now - m_stallStart).GetSeconds();
+        }
+        m_active = false;
+        m_playing = false;
+        m_stalled = false;
+        Simulator::Cancel(m_stallEvent);
+        Simulator::Cancel(m_requestEvent);
+        if (next)
+        {
+            m_sessionEvent = Simulator::Schedule(Seconds(m_offTime->GetValue()), &DashClient::BeginSession, this);
+        }
+    }
+
+    // Contenido en el buffer ahora mismo (s)
+    double BufferLevel() const
+    {
+        double drained = m_playing ? (Simulator::Now() - m_bufferAt).GetSeconds() : 0;
+        return std::max(0.0, m_buffer - drained);
+    }
+
+    uint32_t ChooseQuality() const
+    {
+        double target = 0;
+        if (m_algorithm == "throughput")
+        {
+            if (m_throughput.empty())
+            {
+                return 0;
+            }
+            double inverseSum = 0;
+            for (double t : m_throughput)
+            {
+                inverseSum += 1 / t;
+            }
+            target = 0.9 * m_throughput.size() / inverseSum;
+        }
+        else
+        {
+            double reservoir = 0.2 * m_maxBuffer.GetSeconds();
+            double cushion = 0.6 * m_maxBuffer.GetSeconds();
+            double f = std::clamp((BufferLevel() - reservoir) / cushion, 0.0, 1.0);
+            target = m_ladder[0] + f * (m_ladder[m_topQuality] - m_ladder[0]);
+        }
+        uint32_t q = 0;
+        while (q < m_topQuality && m_ladder[q + 1] <= target)
+        {
+            ++q;
+        }
+        return q;
+    }
+
+    void RequestNext()
+    {
+        if (!m_active || m_downloading)
+        {
+            return;
+        }
+        double segment = m_segmentDuration.GetSeconds();
+        double excess = BufferLevel() + segment - m_maxBuffer.GetSeconds();
+        if (excess > 0)
+        {
+            m_requestEvent = Simulator::Schedule(Seconds(excess), &DashClient::RequestNext, this);
+            return;
+        }
+        uint32_t quality = ChooseQuality();
+        m_requests.push_back({m_session, quality, static_cast<uint64_t>(m_ladder[quality] * segment / 8), Simulator::Now()});
+        m_downloading = true;
+        m_socket->Send(Create<Packet>(reinterpret_cast<const uint8_t*>(&quality), 4));
+    }
+
+    void HandleRead(Ptr<Socket> socket)
+    {
+        while (Ptr<Packet> packet = socket->Recv())
+        {
+            m_receivedBytes += packet->GetSize();
+        }
+        // El servidor responde en orden por la misma conexión: los bytes completan las
+        // peticiones pendientes de una en una
+        while (!m_requests.empty() && m_receivedBytes >= m_requests.front().bytes)
+        {
+            SegmentRequest done = m_requests.front();
+            m_requests.pop_front();
+            m_receivedBytes -= done.bytes;
+            if (!m_requests.empty())
+            {
+                // La siguiente respuesta empieza ahora: su caudal no incluye la espera por esta
+                m_requests.front().requestTime = std::max(m_requests.front().requestTime, Simulator::Now());
+            }
+            // Un segmento pedido en una sesión anterior no cuenta para la actual
+            if (m_active && done.session == m_session)
+            {
+                m_downloading = false;
+                SegmentDownloaded(done);
+            }
+        }
+    }
+
+    void SegmentDownloaded(const SegmentRequest& done)
+    {
+        Time now = Simulator::Now();
+        double segment = m_segmentDuration.GetSeconds();
+        double elapsed = std::max((now - done.requestTime).GetSeconds(), 1e-6);
+        m_throughput.push_back(done.bytes * 8 / elapsed);
+        if (m_throughput.size() > 5)
+        {
+            m_throughput.pop_front();
+        }
+        m_buffer = BufferLevel() + segment;
+        m_bufferAt = now;
+        m_stats.mediaSeconds += segment;
+        m_stats.mediaBits += m_ladder[done.quality] * segment;
+
+        if (!m_playing && !m_stalled && m_buffer >= m_startupSegments * segment - 1e-9)
+        {
+            m_stats.startupDelaySum += (now - m_sessionStart).GetSeconds();
+            ++m_stats.started;
+            StartPlaying();
+        }
+        else if (m_stalled)
+        {
+            m_stats.stallSeconds += (now - m_stallStart).GetSeconds();
+            m_stalled = false;
+            StartPlaying();
+        }
+        else if (m_playing)
+        {
+            Simulator::Cancel(m_stallEvent);
+            m_stallEvent = Simulator::Schedule(Seconds(m_buffer), &DashClient::Stall, this);
+        }
+        RequestNext();
+    }
+
+    void StartPlaying()
+    {
+        m_playing = true;
+        m_playStart = Simulator::Now();
+        m_bufferAt = m_playStart;
+        m_stallEvent = Simulator::Schedule(Seconds(m_buffer), &DashClient::Stall, this);
+    }
+
+    void Stall()
+    {
+        Time now = Simulator::Now();
+        m_stats.playSeconds += (now - m_playStart).GetSeconds();
+        ++m_stats.stalls;
+        m_playing = false;
+        m_stalled = true;
+        m_stallStart = now;
+        m_buffer = 0;
+        m_bufferAt = now;
+    }
+
+    // Configuración
+    Address m_remote;
+    uint16_t m_localPort;
+    std::string m_ladderText;
+    std::vector<uint64_t> m_ladder;
+    uint32_t m_topQuality = 0;
+    Time m_segmentDuration;
+    DataRate m_maxRate;
+    std::string m_algorithm;
+    Time m_maxBuffer;
+    uint32_t m_startupSegments;
+    Ptr<RandomVariableStream> m_onTime;
+    Ptr<RandomVariableStream> m_offTime;
+
+    // Estado de la sesión y de la descarga en curso
+    Ptr<Socket> m_socket;
+    bool m_active = false;
+    bool m_playing = false;
+    bool m_stalled = false;
+    bool m_downloading = false;
+    double m_buffer = 0; // Contenido en el buffer en m_bufferAt (s)
+    Time m_bufferAt;
+    Time m_sessionStart;
+    Time m_playStart;
+    Time m_stallStart;
+    uint32_t m_session = 0; // Sesión de visionado en curso, para descartar segmentos de las anteriores
+    std::deque<SegmentRequest> m_requests; // Peticiones enviadas aún sin respuesta completa
+    uint64_t m_receivedBytes = 0;          // Bytes recibidos de la primera petición pendiente
+    std::deque<double> m_throughput; // Caudal de los últimos segmentos (bps)
+    EventId m_sessionEvent;
+    EventId m_stallEvent;
+    EventId m_requestEvent;
+
+    DashClientStats m_stats;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(DashServer);
+NS_OBJECT_ENSURE_REGISTERED(DashClient);
+
+} // namespace ns3
+
+#endif // DASH_STREAMING_H
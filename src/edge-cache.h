@@ -0,0 +1,179 @@
+#ifndef EDGE_CACHE_H
+#define EDGE_CACHE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <set>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Catálogo de contenidos con popularidad Zipf: el título k (0 = el más popular) se pide con
+ * probabilidad proporcional a 1 / (k + 1)^exponent. La CDF se calcula una vez y cada petición
+ * se obtiene con una búsqueda binaria a partir de un uniforme en [0, 1).
+ */
+class ZipfCatalogue
+{
+  public:
+    ZipfCatalogue(uint32_t titles, double exponent)
+        : m_cdf(std::max(1u, titles))
+    {
+        double sum = 0;
+        for (uint32_t k = 0; k < m_cdf.size(); ++k)
+        {
+            sum += 1 / std::pow(k + 1.0, exponent);
+            m_cdf[k] = sum;
+        }
+        for (double& p : m_cdf)
+        {
+            p /= sum;
+        }
+    }
+
+    uint32_t Titles() const
+    {
+        return m_cdf.size();
+    }
+
+    uint32_t Title(double u) const
+    {
+        auto it = std::upper_bound(m_cdf.begin(), m_cdf.end(), u);
+        return std::min<size_t>(it - m_cdf.begin(), m_cdf.size() - 1);
+    }
+
+  private:
+    std::vector<double> m_cdf;
+};
+
+/**
+ * Caché de borde de 'capacity' títulos con reemplazo LRU o LFU.
+ *
+ * Request() devuelve si el título estaba en la caché; si no estaba, lo guarda (desalojando
+ * otro si está llena), como un servidor de borde que trae de origen el contenido que no tiene.
+ * LFU cuenta todas las peticiones de cada título desde el principio y desaloja el guardado
+ * menos pedido; los empates se deshacen por el uso más antiguo.
+ */
+class EdgeCache
+{
+  public:
+    enum Policy
+    {
+        LRU,
+        LFU
+    };
+
+    EdgeCache(uint32_t capacity, uint32_t titles, Policy policy)
+        : m_capacity(capacity),
+          m_policy(policy),
+          m_requests(policy == LFU ? titles : 0, 0)
+    {
+    }
+
+    bool Request(uint32_t title)
+    {
+        ++m_clock;
+        if (m_policy == LRU)
+        {
+            auto it = m_lruIndex.find(title);
+            if (it != m_lruIndex.end())
+            {
+                m_lru.splice(m_lru.begin(), m_lru, it->second);
+                return true;
+            }
+            if (m_capacity == 0)
+            {
+                return false;
+            }
+            if (m_lru.size() == m_capacity)
+            {
+                m_lruIndex.erase(m_lru.back());
+                m_lru.pop_back();
+            }
+            m_lru.push_front(title);
+            m_lruIndex[title] = m_lru.begin();
+            return false;
+        }
+
+        uint32_t count = m_requests[title]++;
+        auto it = m_lfuIndex.find(title);
+        if (it != m_lfuIndex.end())
+        {
+            m_lfu.erase({count, it->second, title});
+            m_lfu.insert({count + 1, m_clock, title});
+            it->second = m_clock;
+            return true;
+        }
+        if (m_capacity == 0)
+        {
+            return false;
+        }
+        if (m_lfu.size() == m_capacity)
+        {
+            m_lfuIndex.erase(std::get<2>(*m_lfu.begin()));
+            m_lfu.erase(m_lfu.begin());
+        }
+        m_lfu.insert({count + 1, m_clock, title});
+        m_lfuIndex[title] = m_clock;
+        return false;
+    }
+
+  private:
+    uint32_t m_capacity;
+    Policy m_policy;
+    uint64_t m_clock = 0; // Peticiones atendidas, para ordenar por antigüedad
+    // LRU: lista del más reciente al más antiguo e índice por título
+    std::list<uint32_t> m_lru;
+    std::unordered_map<uint32_t, std::list<uint32_t>::iterator> m_lruIndex;
+    // LFU: peticiones de cada título y títulos guardados ordenados por (peticiones, último uso)
+    std::vector<uint32_t> m_requests;
+    std::set<std::tuple<uint32_t, uint64_t, uint32_t>> m_lfu;
+    std::unordered_map<uint32_t, uint64_t> m_lfuIndex; // Título guardado -> último uso
+};
+
+// Configuración de las cachés de borde de las regiones (--edgeCache)
+struct EdgeCacheConfig
+{
+    uint32_t capacity = 0;     // Títulos por caché (0 = sin caché: todo se sirve desde el servidor)
+    uint32_t catalogue = 10000; // Títulos del catálogo
+    double zipf = 0.8;          // Exponente de la popularidad Zipf
+    std::string policy = "lru"; // "lru" o "lfu"
+};
+
+/**
+ * Decide qué sesiones de una región se sirven desde su caché de borde.
+ *
+ * Antes de las sesiones de la réplica, la caché procesa 'warmupRequests' peticiones del mismo
+ * catálogo para llegar a su régimen estacionario; después, cada sesión pide un título y es un
+ * acierto si la caché ya lo tenía. 'uniform' da los uniformes en [0, 1) de las peticiones.
+ */
+template <typename Uniform>
+std::vector<bool>
+PlanEdgeHits(const EdgeCacheConfig& config,
+             const ZipfCatalogue& catalogue,
+             uint32_t sessions,
+             uint64_t warmupRequests,
+             Uniform uniform)
+{
+    EdgeCache cache(config.capacity, catalogue.Titles(), config.policy == "lfu" ? EdgeCache::LFU : EdgeCache::LRU);
+    for (uint64_t i = 0; i < warmupRequests; ++i)
+    {
+        cache.Request(catalogue.Title(uniform()));
+    }
+    std::vector<bool> hits(sessions);
+    for (uint32_t s = 0; s < sessions; ++s)
+    {
+        hits[s] = cache.Request(catalogue.Title(uniform()));
+    }
+    return hits;
+}
+
+} // namespace ns3
+
+#endif // EDGE_CACHE_H
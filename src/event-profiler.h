@@ -0,0 +1,274 @@
+#ifndef EVENT_PROFILER_H
+#define EVENT_PROFILER_H
+
+#include "ns3/default-simulator-impl.h"
+#include "ns3/event-impl.h"
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <cxxabi.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Simulador con perfilado de eventos (--profile).
+ *
+ * Igual que DefaultSimulatorImpl, pero cada evento planificado se envuelve en un
+ * ProfiledEvent que recuerda el tipo de su manejador (la clase y la firma del método, sacadas
+ * del tipo C++ del EventImpl) y el nodo (contexto) en que se ejecuta. Al ejecutarse mide
+ * el tiempo real que tarda. Así se sabe si el tiempo se va en el canal CSMA, en los sockets
+ * TCP, en los temporizadores de las aplicaciones, en RIP o en FlowMonitor.
+ *
+ * El tamaño de la cola de eventos se aproxima con los envoltorios vivos (planificados y aún
+ * no ejecutados ni descartados) y se muestrea cada 'SampleInterval' de tiempo simulado.
+ * Los EventId guardados por las aplicaciones mantienen vivo su último evento, así que la
+ * cifra puede sobrestimar la cola en unos pocos eventos por objeto. Por eso mismo los
+ * contadores viven en un ProfileData compartido: un envoltorio puede destruirse después
+ * que el propio simulador.
+ */
+class ProfilingSimulatorImpl : public DefaultSimulatorImpl
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::ProfilingSimulatorImpl")
+                                .SetParent<DefaultSimulatorImpl>()
+                                .SetGroupName("Core")
+                                .AddConstructor<ProfilingSimulatorImpl>()
+                                .AddAttribute("SampleInterval",
+                                              "Tiempo simulado entre muestras del tamaño de la cola de eventos",
+                                              TimeValue(MilliSeconds(100)),
+                                              MakeTimeAccessor(&ProfilingSimulatorImpl::m_sampleInterval),
+                                              MakeTimeChecker());
+        return tid;
+    }
+
+    EventId Schedule(const Time& delay, EventImpl* event) override
+    {
+        return DefaultSimulatorImpl::Schedule(delay, Wrap(event, GetContext()));
+    }
+
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override
+    {
+        DefaultSimulatorImpl::ScheduleWithContext(context, delay, Wrap(event, context));
+    }
+
+    EventId ScheduleNow(EventImpl* event) override
+    {
+        return DefaultSimulatorImpl::ScheduleNow(Wrap(event, GetContext()));
+    }
+
+    // Da nombre a los nodos en los informes (p. ej. "router1" o "usuarios Valencia");
+    // los nodos sin nombre aparecen como "nodo <id>".
+    void SetNodeLabel(uint32_t nodeId, const std::string& label)
+    {
+        m_nodeLabels[nodeId] = label;
+    }
+
+    /**
+     * Imprime la tabla de los 'topN' pares (manejador, nodo) con más tiempo real y escribe
+     * <prefix>.folded (formato de pilas plegadas de flamegraph.pl, "nodo;manejador µs") y
+     * <prefix>.queue (tiempo simulado y eventos pendientes).
+     */
+    void Report(const std::string& prefix, uint32_t topN) const
+    {
+        struct Row
+        {
+            std::string handler;
+            std::string node;
+            uint64_t count = 0;
+            double seconds = 0;
+        };
+        std::map<std::pair<std::string, std::string>, Row> rows;
+        uint64_t totalCount = 0;
+        double totalSeconds = 0;
+        for (const auto& [key, stats] : m_data->stats)
+        {
+            uint32_t handler = key >> 32;
+            uint32_t node = key & 0xFFFFFFFF;
+            Row& row = rows[{m_handlerNames[handler], NodeLabel(node)}];
+            row.handler = m_handlerNames[handler];
+            row.node = NodeLabel(node);
+            row.count += stats.count;
+            row.seconds += stats.seconds;
+            totalCount += stats.count;
+            totalSeconds += stats.seconds;
+        }
+        std::vector<Row> ranked;
+        for (const auto& [key, row] : rows)
+        {
+            ranked.push_back(row);
+        }
+        std::sort(ranked.begin(), ranked.end(), [](const Row& a, const Row& b) { return a.seconds > b.seconds; });
+
+        std::cout << "--- Perfil de eventos: " << totalCount << " eventos, " << totalSeconds << " s en manejadores, cola máxima "
+                  << m_data->maxPending << " eventos ---" << std::endl;
+        std::cout << "   % tiempo |    Eventos | µs/evento | Nodo | Manejador" << std::endl;
+        for (size_t i = 0; i < ranked.size() && i < topN; ++i)
+        {
+            const Row& r = ranked[i];
+            std::cout << std::fixed << std::setprecision(2) << std::setw(11) << 100 * r.seconds / std::max(totalSeconds, 1e-12)
+                      << " | " << std::setw(10) << r.count << " | " << std::setw(9) << 1e6 * r.seconds / r.count << " | "
+                      << r.node << " | " << r.handler << std::endl;
+        }
+        std::cout << std::defaultfloat;
+
+        std::ofstream folded(prefix + ".folded");
+        for (const Row& r : ranked)
+        {
+            // flamegraph.pl separa los marcos con ';' y el peso con el último espacio
+            std::string handler = r.handler;
+            std::replace(handler.begin(), handler.end(), ';', ',');
+            std::replace(handler.begin(), handler.end(), ' ', '_');
+            std::string node = r.node;
+            std::replace(node.begin(), node.end(), ' ', '_');
+            folded << "onoffRouting;" << node << ";" << handler << " " << static_cast<uint64_t>(r.seconds * 1e6) << "\n";
+        }
+        std::ofstream queue(prefix + ".queue");
+        queue << "# Tiempo(s) EventosPendientes\n";
+        for (const auto& [t, pending] : m_data->queueSamples)
+        {
+            queue << t << " " << pending << "\n";
+        }
+        std::cout << "Pilas plegadas en " << prefix << ".folded (flamegraph.pl " << prefix << ".folded > perfil.svg), "
+                  << "cola de eventos en " << prefix << ".queue" << std::endl;
+    }
+
+  private:
+    struct Stats
+    {
+        uint64_t count = 0;
+        double seconds = 0;
+    };
+
+    // Contadores compartidos entre el simulador y los envoltorios
+    struct ProfileData
+    {
+        uint64_t pending = 0;
+        uint64_t maxPending = 0;
+        double sampleInterval = 0.1;
+        double nextSample = 0;
+        std::unordered_map<uint64_t, Stats> stats; // Clave: manejador << 32 | nodo
+        std::vector<std::pair<double, uint64_t>> queueSamples;
+    };
+
+    // Envoltorio que mide la ejecución del evento original
+    class ProfiledEvent : public EventImpl
+    {
+      public:
+        ProfiledEvent(std::shared_ptr<ProfileData> data, EventImpl* inner, uint32_t handler, uint32_t node)
+            : m_data(std::move(data)),
+              m_inner(inner, false),
+              m_key(static_cast<uint64_t>(handler) << 32 | node)
+        {
+            ++m_data->pending;
+            m_data->maxPending = std::max(m_data->maxPending, m_data->pending);
+        }
+
+        ~ProfiledEvent() override
+        {
+            --m_data->pending;
+        }
+
+      protected:
+        void Notify() override
+        {
+            double now = Simulator::Now().GetSeconds();
+            if (now >= m_data->nextSample)
+            {
+                m_data->queueSamples.emplace_back(now, m_data->pending);
+                m_data->nextSample = now + m_data->sampleInterval;
+            }
+            auto start = std::chrono::steady_clock::now();
+            m_inner->Invoke();
+            Stats& stats = m_data->stats[m_key];
+            stats.seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ++stats.count;
+        }
+
+      private:
+        std::shared_ptr<ProfileData> m_data;
+        Ptr<EventImpl> m_inner;
+        uint64_t m_key;
+    };
+
+    EventImpl* Wrap(EventImpl* event, uint32_t context)
+    {
+        m_data->sampleInterval = m_sampleInterval.GetSeconds();
+        return new ProfiledEvent(m_data, event, HandlerId(event), context);
+    }
+
+    // Identificador del tipo de manejador. El tipo C++ del EventImpl lo genera MakeEvent a
+    // partir del puntero al método, así que incluye la clase y la firma del manejador.
+    uint32_t HandlerId(EventImpl* event)
+    {
+        std::type_index type(typeid(*event));
+        auto it = m_handlerIds.find(type);
+        if (it != m_handlerIds.end())
+        {
+            return it->second;
+        }
+        uint32_t id = m_handlerNames.size();
+        m_handlerNames.push_back(HandlerName(type.name()));
+        m_handlerIds.emplace(type, id);
+        return id;
+    }
+
+    // "ns3::MakeEvent<void (ns3::CsmaNetDevice::*)(), ns3::CsmaNetDevice*>(...)::EventMemberImpl0"
+    // -> "ns3::CsmaNetDevice::*()"
+    static std::string HandlerName(const char* mangled)
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+        std::string name = status == 0 ? demangled : mangled;
+        std::free(demangled);
+        size_t member = name.find("::*)(");
+        if (member != std::string::npos)
+        {
+            size_t open = name.rfind('(', member);
+            size_t close = name.find(')', member + 5);
+            if (open != std::string::npos && close != std::string::npos)
+            {
+                return name.substr(open + 1, member - open - 1) + "::*" + name.substr(member + 4, close - member - 3);
+            }
+        }
+        return name.size() > 120 ? name.substr(0, 117) + "..." : name;
+    }
+
+    std::string NodeLabel(uint32_t node) const
+    {
+        if (node == Simulator::NO_CONTEXT)
+        {
+            return "sin nodo";
+        }
+        auto it = m_nodeLabels.find(node);
+        return it != m_nodeLabels.end() ? it->second : "nodo " + std::to_string(node);
+    }
+
+    Time m_sampleInterval;
+    std::shared_ptr<ProfileData> m_data = std::make_shared<ProfileData>();
+    std::unordered_map<std::type_index, uint32_t> m_handlerIds;
+    std::vector<std::string> m_handlerNames;
+    std::map<uint32_t, std::string> m_nodeLabels;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(ProfilingSimulatorImpl);
+
+} // namespace ns3
+
+#endif // EVENT_PROFILER_H
@@ -0,0 +1,285 @@
+#ifndef MULTI_SESSION_SERVER_H
+#define MULTI_SESSION_SERVER_H
+
+#include "ns3/address.h"
+#include "ns3/application.h"
+#include "ns3/data-rate.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/pointer.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/simulator.h"
+#include "ns3/socket.h"
+#include "ns3/string.h"
+#include "ns3/tcp-socket-factory.h"
+#include "ns3/traced-callback.h"
+#include "ns3/uinteger.h"
+
+#include <functional>
+#include <map>
+#include <queue>
+#include <vector>
+
+namespace ns3
+{
+
+/**
+ * Servidor de streaming que atiende todas las sesiones de una clase de tráfico desde
+ * un único objeto Application.
+ *
+ * Cada sesión reproduce el comportamiento de un OnOffApplication de tasa constante
+ * (arranca en "off", periodos on/off con las mismas variables aleatorias y bits
+ * residuales entre periodos), pero el estado se guarda en vectores planos indexados
+ * por sesión y todos los envíos y cambios de periodo se planifican con un único
+ * temporizador sobre un montículo de próximos eventos. Así el Simulator solo tiene
+ * un evento pendiente por servidor en lugar de dos por espectador.
+ *
+ * TCP sigue necesitando un socket por conexión, por lo que se mantiene un socket por sesión.
+ */
+class MultiSessionServer : public Application
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid =
+            TypeId("ns3::MultiSessionServer")
+                .SetParent<Application>()
+                .SetGroupName("Applications")
+                .AddConstructor<MultiSessionServer>()
+                .AddAttribute("PacketSize",
+                              "Tamaño de los paquetes enviados en los periodos on",
+                              UintegerValue(512),
+                              MakeUintegerAccessor(&MultiSessionServer::m_pktSize),
+                              MakeUintegerChecker<uint32_t>(1))
+                .AddAttribute("OffTime",
+                              "Variable aleatoria para la duración de los periodos off (s)",
+                              StringValue("ns3::ConstantRandomVariable[Constant=1.0]"),
+                              MakePointerAccessor(&MultiSessionServer::m_offTime),
+                              MakePointerChecker<RandomVariableStream>())
+                .AddAttribute("Protocol",
+                              "Factoría de sockets usada para las sesiones",
+                              TypeIdValue(TcpSocketFactory::GetTypeId()),
+                              MakeTypeIdAccessor(&MultiSessionServer::m_tid),
+                              MakeTypeIdChecker())
+                .AddTraceSource("Tx",
+                                "Paquete enviado por cualquiera de las sesiones",
+                                MakeTraceSourceAccessor(&MultiSessionServer::m_txTrace),
+                                "ns3::Packet::TracedCallback");
+        return tid;
+    }
+
+    MultiSessionServer()
+        : m_pktSize(512),
+          m_timerSet(false)
+    {
+    }
+
+    // Añade una sesión hacia 'remote' a tasa constante 'rate' con su variable de periodo on y,
+    // opcionalmente, su propia variable de periodo off (si no, se usa el atributo OffTime)
+    void AddSession(const Address& remote,
+                    DataRate rate,
+                    Ptr<RandomVariableStream> onTime,
+                    Ptr<RandomVariableStream> offTime = nullptr)
+    {
+        m_peer.push_back(remote);
+        m_rateBps.push_back(rate.GetBitRate());
+        m_onTime.push_back(onTime);
+        m_sessionOffTime.push_back(offTime);
+        m_socket.push_back(nullptr);
+        m_on.push_back(0);
+        m_residualBits.push_back(0);
+        m_lastStart.push_back(Time(0));
+        m_nextTx.push_back(Time(0));
+        m_phaseEnd.push_back(Time(0));
+    }
+
+    uint32_t GetNSessions() const
+    {
+        return m_peer.size();
+    }
+
+  protected:
+    void DoDispose() override
+    {
+        m_socket.clear();
+        m_onTime.clear();
+        m_sessionOffTime.clear();
+        m_offTime = nullptr;
+        m_socketIndex.clear();
+        Application::DoDispose();
+    }
+
+  private:
+    // Entrada del montículo: instante del próximo evento de una sesión
+    using Entry = std::pair<Time, uint32_t>;
+
+    void StartApplication() override
+    {
+        for (uint32_t i = 0; i < m_peer.size(); ++i)
+        {
+            Ptr<Socket> socket = Socket::CreateSocket(GetNode(), m_tid);
+            if (InetSocketAddress::IsMatchingType(m_peer[i]))
+            {
+                socket->Bind();
+            }
+            else
+            {
+                socket->Bind6();
+            }
+            socket->Connect(m_peer[i]);
+            socket->ShutdownRecv();
+            socket->SetConnectCallback(MakeCallback(&MultiSessionServer::ConnectionSucceeded, this),
+                                       MakeCallback(&MultiSessionServer::ConnectionFailed, this));
+            m_socket[i] = socket;
+            m_socketIndex[socket] = i;
+        }
+    }
+
+    void StopApplication() override
+    {
+        Simulator::Cancel(m_timer);
+        m_timerSet = false;
+        m_heap = {};
+        for (uint32_t i = 0; i < m_socket.size(); ++i)
+        {
+            if (m_socket[i])
+            {
+                m_socket[i]->Close();
+            }
+            m_on[i] = 0;
+        }
+    }
+
+    void ConnectionSucceeded(Ptr<Socket> socket)
+    {
+        auto it = m_socketIndex.find(socket);
+        if (it == m_socketIndex.end())
+        {
+            return;
+        }
+        // Igual que OnOffApplication: la sesión empieza en un periodo off
+        uint32_t i = it->second;
+        m_phaseEnd[i] = Simulator::Now() + Seconds(OffTime(i)->GetValue());
+        Push(i);
+    }
+
+    void ConnectionFailed(Ptr<Socket>)
+    {
+        NS_FATAL_ERROR("MultiSessionServer: no se pudo conectar una sesión");
+    }
+
+    Ptr<RandomVariableStream> OffTime(uint32_t i) const
+    {
+        return m_sessionOffTime[i] ? m_sessionOffTime[i] : m_offTime;
+    }
+
+    // Próximo evento de la sesión i: envío (si está en on) o fin del periodo actual
+    Time NextEvent(uint32_t i) const
+    {
+        return (m_on[i] && m_nextTx[i] < m_phaseEnd[i]) ? m_nextTx[i] : m_phaseEnd[i];
+    }
+
+    void Push(uint32_t i)
+    {
+        Time t = NextEvent(i);
+        m_heap.push({t, i});
+        if (!m_timerSet || t < m_timerAt)
+        {
+            Simulator::Cancel(m_timer);
+            m_timerAt = t;
+            m_timerSet = true;
+            m_timer = Simulator::Schedule(t - Simulator::Now(), &MultiSessionServer::OnTimer, this);
+        }
+    }
+
+    // Atiende todas las sesiones cuyo próximo evento ha vencido y reprograma el temporizador
+    void OnTimer()
+    {
+        m_timerSet = false;
+        Time now = Simulator::Now();
+        while (!m_heap.empty() && m_heap.top().first <= now)
+        {
+            auto [t, i] = m_heap.top();
+            m_heap.pop();
+            if (t != NextEvent(i))
+            {
+                continue; // Entrada obsoleta
+            }
+            if (m_on[i] && m_nextTx[i] <= now && m_nextTx[i] < m_phaseEnd[i])
+            {
+                SendPacket(i);
+            }
+            else if (m_on[i])
+            {
+                // Fin del periodo on: se guardan los bits acumulados desde el último envío
+                m_residualBits[i] += static_cast<uint64_t>((now - m_lastStart[i]).GetSeconds() * m_rateBps[i]);
+                m_on[i] = 0;
+                m_phaseEnd[i] = now + Seconds(OffTime(i)->GetValue());
+            }
+            else
+            {
+                m_on[i] = 1;
+                m_lastStart[i] = now;
+                ScheduleNextTx(i);
+                m_phaseEnd[i] = now + Seconds(m_onTime[i]->GetValue());
+            }
+            m_heap.push({NextEvent(i), i});
+        }
+        if (!m_heap.empty())
+        {
+            m_timerAt = m_heap.top().first;
+            m_timerSet = true;
+            m_timer = Simulator::Schedule(m_timerAt - now, &MultiSessionServer::OnTimer, this);
+        }
+    }
+
+    void ScheduleNextTx(uint32_t i)
+    {
+        uint64_t bits = static_cast<uint64_t>(m_pktSize) * 8;
+        bits = bits > m_residualBits[i] ? bits - m_residualBits[i] : 0;
+        m_nextTx[i] = Simulator::Now() + Seconds(bits / static_cast<double>(m_rateBps[i]));
+    }
+
+    void SendPacket(uint32_t i)
+    {
+        Ptr<Packet> packet = Create<Packet>(m_pktSize);
+        m_txTrace(packet);
+        m_socket[i]->Send(packet);
+        m_lastStart[i] = Simulator::Now();
+        m_residualBits[i] = 0;
+        ScheduleNextTx(i);
+    }
+
+    uint32_t m_pktSize;
+    Ptr<RandomVariableStream> m_offTime;
+    TypeId m_tid;
+
+    // Estado de las sesiones en vectores planos (uno por campo, indexados por sesión)
+    std::vector<Address> m_peer;
+    std::vector<uint64_t> m_rateBps;
+    std::vector<Ptr<RandomVariableStream>> m_onTime;
+    std::vector<Ptr<RandomVariableStream>> m_sessionOffTime; // Nulo = atributo OffTime
+    std::vector<Ptr<Socket>> m_socket;
+    std::vector<uint8_t> m_on;
+    std::vector<uint64_t> m_residualBits;
+    std::vector<Time> m_lastStart;
+    std::vector<Time> m_nextTx;
+    std::vector<Time> m_phaseEnd;
+    std::map<Ptr<Socket>, uint32_t> m_socketIndex; // Solo para las callbacks de conexión
+
+    // Temporizador compartido
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> m_heap;
+    EventId m_timer;
+    Time m_timerAt;
+    bool m_timerSet;
+
+    TracedCallback<Ptr<const Packet>> m_txTrace;
+};
+
+NS_OBJECT_ENSURE_REGISTERED(MultiSessionServer);
+
+} // namespace ns3
+
+#endif // MULTI_SESSION_SERVER_H
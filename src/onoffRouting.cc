@@ -6,6 +6,7 @@
 #include "ns3/csma-helper.h"
 #include "ns3/data-rate.h"
 #include "ns3/flow-monitor-helper.h"
+#include "ns3/histogram.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/ipv4-address-helper.h"
 #include "ns3/ipv4-flow-classifier.h"
@@ -23,196 +24,2080 @@
 #include "ns3/rip-helper.h"
 #include "ns3/rng-seed-manager.h"
 #include "ns3/simulator.h"
-#include "ns3/ipv4-global-routing-helper.h" 
+#include "ns3/ipv4-global-routing-helper.h"
+#ifdef NS3_MPI
+#include "ns3/mpi-interface.h"
+#endif
+#include "ns3/ipv4-routing-helper.h"
+#include "ns3/ipv4-static-routing.h"
+#include "bottleneck-qdisc.h"
+#include "dash-streaming.h"
+#include "edge-cache.h"
+#include "event-profiler.h"
+#include "multi-session-server.h"
+#include "output-analysis.h"
+#include "qos-probe.h"
+#include "qos-stats.h"
+#include "queue-trace.h"
+#include "results-store.h"
+#include "tcp-config.h"
+#include "topology.h"
+#include "user-qos.h"
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <functional>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 
 using namespace ns3;
 
 NS_LOG_COMPONENT_DEFINE("OnOffRoutingExperiment");
 
-int
-main(int argc, char* argv[])
+// --- CONFIGURACIÓN Y RESULTADO DE UNA RÉPLICA ---
+struct ReplicaConfig
 {
-    // --- PARÁMETROS DE SIMULACIÓN ---
-    bool enableLogs = false; // <--  Flag para controlar los logs
-    uint32_t num_usuarios = 100;
-    std::string bitrate_str = "8Mbps";
-    uint32_t semilla = 1;
+    uint32_t numUsuarios;
+    double bitrateMbps; // Bitrate del enlace L1 (router1 -> router2)
+    uint32_t semilla;   // Semilla base (RngSeedManager::SetSeed), común a todas las réplicas
+    uint32_t run;       // Número de ejecución (RngSeedManager::SetRun); distingue las réplicas
+    bool antithetic;    // Fuentes de tráfico con variables antitéticas (1 - u)
+    bool enableLogs;
+    std::string serverApp; // "onoff" (un OnOffApplication por usuario), "aggregated" o "dash"
+    std::string metrics;   // "flowmon" (FlowMonitorHelper::InstallAll) o "probe" (QosProbe)
+    std::string queueTrace;     // Prefijo de la serie temporal de la cola cuello de botella ("" = desactivada)
+    double queueTraceInterval; // Intervalo de muestreo de la cola (s)
+    std::string routing;       // "rip", "global" o "static"
+    TopologySpec topology;     // Regiones, clases, enlaces y direcciones (ver topology.h)
+    uint32_t mpiRanks;         // Procesos MPI de la simulación distribuida (1 = secuencial)
+    std::string qdisc;         // Disciplina de cola del cuello de botella ("" = la de ns-3 por defecto)
+    std::string deviceQueue;   // Cola del dispositivo del cuello de botella con --qdisc (p. ej. "5p")
+    std::string dashLadder;    // serverApp=dash: escalera de bitrates ("" = las tasas de las clases)
+    double dashSegment;        // serverApp=dash: duración de los segmentos (s)
+    std::string dashAbr;       // serverApp=dash: adaptación "buffer" o "throughput"
+    std::string profile;       // Prefijo de los ficheros del perfil de eventos ("" = sin perfilar)
+    uint32_t profileTop;       // Filas de la tabla del perfil de eventos
+    bool snapshot;             // Barrido con --snapshot: un escenario construido por número de usuarios
+    bool earlyStop;            // Detener la réplica cuando su resultado de QoS está decidido
+    bool warmup;               // Descartar de las métricas el transitorio detectado con MSER
+    double runPrecision;       // Detener la réplica cuando el IC alcanza esta precisión relativa (0 = no)
+    double analysisWindow;     // Intervalo de medida del análisis de salida (s)
+    uint32_t analysisMinWindows; // Intervalos mínimos tras el transitorio antes de detener la réplica
+    std::string intervalTrace; // Prefijo del fichero con las métricas por intervalo ("" = sin fichero)
+    EdgeCacheConfig edgeCache; // Cachés de borde en los routers de región (capacidad 0 = desactivadas)
+    TcpConfig tcp;             // Control de congestión, pacing, ventana inicial y buffers de TCP
+};
 
-    CommandLine cmd;
-    cmd.AddValue("enableLogs", "Habilitar logs detallados", enableLogs); // <-- argumento para activar logs
-    cmd.AddValue("num_usuarios", "Numero de usuarios a simular", num_usuarios);
-    cmd.AddValue("bitrate", "Bitrate del enlace L1", bitrate_str);
-    cmd.AddValue("semilla", "Semilla para el generador aleatorio", semilla);
-    cmd.Parse(argc, argv);
+struct ReplicaResult
+{
+    uint32_t numUsuarios;
+    double bitrateMbps;
+    double lossRatio; // %
+    double delayMs;
+    double jitterMs;
+    double wallSeconds; // Tiempo real de la réplica
+    long peakRssKb;     // Memoria residente máxima del proceso
+    // Calidad de experiencia de los clientes con serverApp=dash (0 en los demás modos)
+    double startupDelayS;
+    double rebufferRatio; // %
+    double avgBitrateKbps;
+    // Coste de la simulación
+    double simSeconds;          // Tiempo simulado
+    uint64_t events;            // Eventos ejecutados por el Simulator
+    uint64_t bottleneckPackets; // Paquetes transmitidos por router1 hacia el cuello de botella
+    // Análisis de salida: las réplicas detenidas antes del final tienen las métricas acumuladas hasta simSeconds
+    bool earlyStop;             // Detenida con el resultado de QoS decidido
+    bool precisionStop;         // Detenida al alcanzar la precisión pedida
+    double warmupSeconds;       // Transitorio descartado de las métricas
+    UserQosStats users;         // Fracción de usuarios que cumple cada umbral y percentiles del retardo
+    double edgeHitRatio;        // Fracción de las sesiones servidas por las cachés de borde
+};
 
-   
-    if (enableLogs)
+// Contador de paquetes para trazas sin contexto
+void
+CountPacket(uint64_t* counter, Ptr<const Packet>)
+{
+    ++*counter;
+}
+
+// Vuelca un histograma de FlowMonitor (casillas de anchura fija en segundos) en un LatencySketch
+LatencySketch
+SketchFromHistogram(const Histogram& histogram)
+{
+    LatencySketch sketch;
+    for (uint32_t i = 0; i < histogram.GetNBins(); ++i)
     {
-        LogComponentEnable("OnOffRoutingExperiment", LOG_LEVEL_ALL);
-        NS_LOG_FUNCTION(argc << argv);
-        NS_LOG_INFO("Iniciando simulación con los siguientes parámetros:");
-        NS_LOG_INFO("  - Número de Usuarios Totales: " << num_usuarios);
-        NS_LOG_INFO("  - Bitrate del enlace L1: " << bitrate_str);
-        NS_LOG_INFO("  - Semilla: " << semilla);
+        if (histogram.GetBinCount(i) > 0)
+        {
+            sketch.AddMs((histogram.GetBinStart(i) + histogram.GetBinWidth(i) / 2) * 1000, histogram.GetBinCount(i));
+        }
     }
+    return sketch;
+}
 
+// --- INSTANTÁNEAS TRAS LA PREPARACIÓN (--snapshot) ---
+// Réplicas de un mismo número de usuarios que continúan desde un único escenario construido
+struct SnapshotPlan
+{
+    std::vector<ReplicaConfig> tasks;
+    uint32_t jobs;      // Hijos simultáneos (0 = todos los núcleos)
+    size_t current = 0; // En cada hijo, índice de la réplica que le toca
+};
 
-    RngSeedManager::SetSeed(semilla);
-    Time::SetResolution(Time::US);
+// Crea un hijo por réplica del plan, como mucho plan.jobs a la vez. Solo vuelve en los
+// hijos, con plan.current apuntando a su réplica; el proceso que tiene la instantánea espera a
+// que terminen todos y acaba sin volver.
+void
+ForkFromSnapshot(SnapshotPlan& plan)
+{
+    uint32_t jobs = plan.jobs ? plan.jobs : std::max(1u, std::thread::hardware_concurrency());
+    std::map<pid_t, size_t> children;
+    size_t next = 0;
+    while (next < plan.tasks.size() || !children.empty())
+    {
+        while (next < plan.tasks.size() && children.size() < jobs)
+        {
+            std::cout.flush();
+            std::cerr.flush();
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                NS_FATAL_ERROR("fork() ha fallado: " << std::strerror(errno));
+            }
+            if (pid == 0)
+            {
+                plan.current = next;
+                return;
+            }
+            children[pid] = next++;
+        }
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            NS_FATAL_ERROR("waitpid() ha fallado: " << std::strerror(errno));
+        }
+        children.erase(pid);
+    }
+    std::cout.flush();
+    _exit(0);
+}
 
-    double bitrate_val = std::stod(bitrate_str.substr(0, bitrate_str.find("Mbps")));
-
-    // --- NODOS Y PILA DE RED ---
-    uint32_t numValFHD = num_usuarios * 0.7 * 0.7;
-    uint32_t numValHD = num_usuarios * 0.2 * 0.7;
-    uint32_t numValSD = num_usuarios * 0.1 * 0.7;
-    uint32_t numBalFHD = num_usuarios * 0.7 * 0.3;
-    uint32_t numBalHD = num_usuarios * 0.2 * 0.3;
-    uint32_t numBalSD = num_usuarios * 0.1 * 0.3;
-    uint32_t num_usuarios_valencia = numValFHD + numValHD + numValSD;
-    uint32_t num_usuarios_baleares = numBalFHD + numBalHD + numBalSD;
-
-    NodeContainer allNodes, serverNode, routerNodes, valenciaUsers, balearesUsers;
-    serverNode.Create(1);
-    routerNodes.Create(3);
-    if (num_usuarios_valencia > 0) valenciaUsers.Create(num_usuarios_valencia);
-    if (num_usuarios_baleares > 0) balearesUsers.Create(num_usuarios_baleares);
-
-    allNodes.Add(serverNode);
-    allNodes.Add(routerNodes);
-    allNodes.Add(valenciaUsers);
-    allNodes.Add(balearesUsers);
-    
-    if (enableLogs) {
-        NS_LOG_INFO("Nodos creados: 1 Servidor, 3 Routers, " << num_usuarios_valencia << " usuarios en Valencia, " << num_usuarios_baleares << " en Baleares.");
+// Ejecuta una réplica completa del escenario y devuelve las métricas agregadas.
+// Crea y destruye el Simulator, por lo que en modo barrido se llama desde un proceso hijo.
+// Con 'plan' (--snapshot) construye el escenario una vez, lo lleva hasta el arranque del
+// tráfico y sigue en un hijo por réplica del plan (ver ForkFromSnapshot): solo vuelve en ellos.
+ReplicaResult
+RunReplica(const ReplicaConfig& base, SnapshotPlan* plan = nullptr)
+{
+    auto wallStart = std::chrono::steady_clock::now();
+    ReplicaConfig cfg = base; // En los hijos de una instantánea cambian bitrate, ejecución y antitéticas
+    if (cfg.enableLogs)
+    {
+        NS_LOG_INFO("Iniciando simulación con los siguientes parámetros:");
+        NS_LOG_INFO("  - Número de Usuarios Totales: " << cfg.numUsuarios);
+        NS_LOG_INFO("  - Bitrate del enlace L1: " << cfg.bitrateMbps << "Mbps");
+        NS_LOG_INFO("  - Semilla: " << cfg.semilla << ", ejecución: " << cfg.run << (cfg.antithetic ? " (antitética)" : ""));
+    }
+
+    // Misma semilla para todas las réplicas; cada réplica usa su propia ejecución (subflujos
+    // independientes del generador). Los flujos se asignan explícitamente más abajo.
+    RngSeedManager::SetSeed(cfg.semilla);
+    RngSeedManager::SetRun(cfg.run);
+
+    // El perfilado sustituye la implementación del Simulator: debe elegirse antes de usarlo
+    if (!cfg.profile.empty()) {
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::ProfilingSimulatorImpl"));
     }
 
+    // Variante de TCP y parámetros de los sockets, antes de crear la pila y las aplicaciones
+    ApplyTcpConfig(cfg.tcp);
+
+    DataRate bottleneckRate(static_cast<uint64_t>(cfg.bitrateMbps * 1e6));
+
+    // --- NODOS, PILA DE RED Y DIRECCIONES ---
+    // Con routing=rip las tablas se aprenden durante la simulación y las aplicaciones esperan
+    // 10 s a que RIP converja. Con global y static las tablas se rellenan antes de Run(), así
+    // que el tráfico empieza en t=0 y no hay eventos de control de encaminamiento.
     InternetStackHelper stack;
     Ipv4ListRoutingHelper listRouting;
     listRouting.Add(Ipv4StaticRoutingHelper(), 0);
-    listRouting.Add(RipHelper(), 10);
+    if (cfg.routing == "rip") {
+        listRouting.Add(RipHelper(), 10);
+    } else if (cfg.routing == "global") {
+        listRouting.Add(Ipv4GlobalRoutingHelper(), -10);
+    }
     stack.SetRoutingHelper(listRouting);
-    stack.Install(allNodes);
 
-    // --- TOPOLOGÍA Y DIRECCIONES IP ---
-    CsmaHelper backboneCsma, lanCsma;
-    
-    backboneCsma.SetChannelAttribute("DataRate", DataRateValue(DataRate("1Gbps")));
-    lanCsma.SetChannelAttribute("DataRate", DataRateValue(DataRate("100Mbps")));
-    Ipv4AddressHelper ipHelper;
-
-    Ipv4InterfaceContainer serverRouter1Interfaces;
-    ipHelper.SetBase("10.1.1.0", "255.255.255.0");
-    serverRouter1Interfaces = ipHelper.Assign(backboneCsma.Install(NodeContainer(serverNode.Get(0), routerNodes.Get(0))));
-
-    Ipv4InterfaceContainer router1Router2Interfaces;
-    backboneCsma.SetChannelAttribute("DataRate", DataRateValue(DataRate(bitrate_str)));
-    ipHelper.SetBase("20.1.1.0", "255.255.255.0");
-    router1Router2Interfaces = ipHelper.Assign(backboneCsma.Install(NodeContainer(routerNodes.Get(0), routerNodes.Get(1))));
-    
-    Ipv4InterfaceContainer router1Router3Interfaces;
-    backboneCsma.SetChannelAttribute("DataRate", DataRateValue(DataRate("1Gbps")));
-    ipHelper.SetBase("30.1.1.0", "255.255.255.0");
-    router1Router3Interfaces = ipHelper.Assign(backboneCsma.Install(NodeContainer(routerNodes.Get(0), routerNodes.Get(2))));
+    // Servidor, router1 y un router y una LAN por región, según la descripción de la topología
+    const TopologySpec& spec = cfg.topology;
+    BuiltTopology topo = BuildTopology(spec, cfg.numUsuarios, bottleneckRate, stack, cfg.mpiRanks);
+    Ptr<Node> server = topo.server;
+
+    // En la simulación distribuida cada proceso solo instala aplicaciones y sondas en sus nodos
+    uint32_t rank = 0;
+#ifdef NS3_MPI
+    if (cfg.mpiRanks > 1) rank = MpiInterface::GetSystemId();
+#endif
+    bool serverIsLocal = server->GetSystemId() == rank;
+
+    Ptr<ProfilingSimulatorImpl> profiler = DynamicCast<ProfilingSimulatorImpl>(Simulator::GetImplementation());
+    if (profiler) {
+        profiler->SetNodeLabel(server->GetId(), "servidor");
+        profiler->SetNodeLabel(topo.core->GetId(), "router1");
+        for (const auto& region : topo.regions) {
+            profiler->SetNodeLabel(region.router->GetId(), "router " + region.name);
+            for (uint32_t i = 0; i < region.users.GetN(); ++i) profiler->SetNodeLabel(region.users.Get(i)->GetId(), "usuarios " + region.name);
+        }
+    }
+    Ipv4Address serverAddress = topo.serverInterfaces.GetAddress(0);
 
-    Ipv4InterfaceContainer valenciaInterfaces, balearesInterfaces;
-    if (num_usuarios_valencia > 0) {
-        ipHelper.SetBase("40.1.0.0", "255.255.252.0"); 
-        valenciaInterfaces = ipHelper.Assign(lanCsma.Install(NodeContainer(routerNodes.Get(1), valenciaUsers)));
+    if (cfg.enableLogs) {
+        std::ostringstream perRegion;
+        for (const auto& region : topo.regions) perRegion << ", " << region.numUsers << " usuarios en " << region.name << " (" << region.users.GetN() << " nodos)";
+        NS_LOG_INFO("Nodos creados: 1 Servidor, " << 1 + topo.regions.size() << " Routers" << perRegion.str() << ".");
     }
-    if (num_usuarios_baleares > 0) {
-        ipHelper.SetBase("50.1.0.0", "255.255.252.0");
-        balearesInterfaces = ipHelper.Assign(lanCsma.Install(NodeContainer(routerNodes.Get(2), balearesUsers)));
+
+    if (cfg.routing == "global") {
+        Ipv4GlobalRoutingHelper::PopulateRoutingTables();
+    } else if (cfg.routing == "static") {
+        // Todo el tráfico pasa por router1: el servidor, los routers de región y los usuarios
+        // solo necesitan su ruta por defecto y router1 una ruta hacia cada LAN de usuarios.
+        Ipv4StaticRoutingHelper staticHelper;
+        auto defaultRoute = [&](Ptr<Node> node, Ipv4Address gateway) {
+            staticHelper.GetStaticRouting(node->GetObject<Ipv4>())->SetDefaultRoute(gateway, 1);
+        };
+        Ptr<Ipv4StaticRouting> router1 = staticHelper.GetStaticRouting(topo.core->GetObject<Ipv4>());
+        defaultRoute(server, topo.serverInterfaces.GetAddress(1));
+        for (const auto& region : topo.regions) {
+            defaultRoute(region.router, region.uplinkInterfaces.GetAddress(0));
+            if (region.numUsers == 0) continue;
+            size_t slash = region.lanNetwork.find('/');
+            router1->AddNetworkRouteTo(Ipv4Address(region.lanNetwork.substr(0, slash).c_str()), Ipv4Mask(region.lanNetwork.substr(slash).c_str()), region.uplinkInterfaces.GetAddress(1), region.uplinkInterface);
+            for (uint32_t i = 0; i < region.users.GetN(); ++i) defaultRoute(region.users.Get(i), region.nodeGateways[i]);
+        }
     }
 
-    if (enableLogs)
+    // --- INSTANTES DEL EXPERIMENTO ---
+    // 30 s de tráfico y 5 s más para vaciar las colas, tras la convergencia de RIP si se usa
+    Time startTime = cfg.routing == "rip" ? Seconds(10.0) : Seconds(0.0);
+    Time appStopTime = startTime + Seconds(30.0);
+    Time simStopTime = startTime + Seconds(35.0);
+
+    if (cfg.enableLogs)
     {
         NS_LOG_DEBUG("--- Direcciones IP Asignadas ---");
-        NS_LOG_DEBUG("Servidor: " << serverRouter1Interfaces.GetAddress(0));
-        NS_LOG_DEBUG("Router 1 (eth0): " << serverRouter1Interfaces.GetAddress(1));
-        NS_LOG_DEBUG("Router 1 (eth1): " << router1Router2Interfaces.GetAddress(0));
-        NS_LOG_DEBUG("Router 2 (eth0): " << router1Router2Interfaces.GetAddress(1));
-        NS_LOG_DEBUG("Router 1 (eth2): " << router1Router3Interfaces.GetAddress(0));
-        NS_LOG_DEBUG("Router 3 (eth0): " << router1Router3Interfaces.GetAddress(1));
-        if (num_usuarios_valencia > 0) NS_LOG_DEBUG("Router 2 (LAN Valencia): " << valenciaInterfaces.GetAddress(0));
-        if (num_usuarios_baleares > 0) NS_LOG_DEBUG("Router 3 (LAN Baleares): " << balearesInterfaces.GetAddress(0));
+        NS_LOG_DEBUG("Servidor: " << topo.serverInterfaces.GetAddress(0));
+        NS_LOG_DEBUG("Router 1 (eth0): " << topo.serverInterfaces.GetAddress(1));
+        for (size_t r = 0; r < topo.regions.size(); ++r) {
+            const BuiltRegion& region = topo.regions[r];
+            NS_LOG_DEBUG("Router 1 (eth" << r + 1 << "): " << region.uplinkInterfaces.GetAddress(0));
+            NS_LOG_DEBUG("Router " << r + 2 << " (eth0): " << region.uplinkInterfaces.GetAddress(1));
+            if (region.numUsers > 0) NS_LOG_DEBUG("Router " << r + 2 << " (acceso " << region.name << "): " << region.nodeGateways[0] << " en " << region.lanNetwork);
+        }
         NS_LOG_DEBUG("---------------------------------");
 
-        NS_LOG_INFO("Se ha programado la impresión de las tablas de enrutamiento en t=11s.");
-        RipHelper routingHelper;
+        NS_LOG_INFO("Se ha programado la impresión de las tablas de enrutamiento en t=" << (startTime + Seconds(1.0)).GetSeconds() << "s.");
         Ptr<OutputStreamWrapper> routingStream = Create<OutputStreamWrapper>(&std::cout);
-        routingHelper.PrintRoutingTableAllAt(Seconds(11.0), routingStream);
+        Ipv4RoutingHelper::PrintRoutingTableAllAt(startTime + Seconds(1.0), routingStream);
+    }
+
+    // --- GESTIÓN DE LA COLA DEL CUELLO DE BOTELLA ---
+    // La disciplina se instala en router1, en el sentido servidor -> usuarios del primer
+    // enlace 'bottleneck'. Sin --qdisc se deja la configuración de siempre.
+    Ptr<QueueDisc> bottleneckQdisc;
+    if (!cfg.qdisc.empty()) {
+        NS_ABORT_MSG_IF(topo.bottleneckDevices.GetN() == 0, "--qdisc necesita un enlace 'bottleneck' en la topología");
+        Time bottleneckDelay;
+        for (const auto& region : spec.regions) {
+            if (region.uplink.bottleneck) { bottleneckDelay = region.uplink.delay; break; }
+        }
+        bottleneckQdisc = InstallBottleneckQdisc(topo.bottleneckDevices.Get(0), ParseQdiscSpec(cfg.qdisc), cfg.deviceQueue, bottleneckRate, bottleneckDelay);
     }
 
+    // --- FLUJOS ALEATORIOS ---
+    // Cada sesión tiene sus propias variables on/off con flujos fijos (2g y 2g+1 para la sesión
+    // g, en orden región, clase, usuario), que no dependen del bitrate ni del orden en que se
+    // consumen los números durante la simulación. Así, con la misma ejecución, un espectador
+    // se comporta igual en todos los bitrates (números aleatorios comunes). La infraestructura
+    // (ARP, backoff de CSMA, RIP) usa flujos a partir de INFRA_STREAM_BASE.
+    // Reasignar los flujos vuelve a sembrar las variables con la ejecución actual
+    auto assignInfrastructureStreams = [&]() {
+        const int64_t INFRA_STREAM_BASE = int64_t(1) << 32;
+        int64_t stream = INFRA_STREAM_BASE;
+        stream += stack.AssignStreams(topo.allNodes, stream);
+        for (uint32_t n = 0; n < topo.allNodes.GetN(); ++n) {
+            Ptr<Node> node = topo.allNodes.Get(n);
+            for (uint32_t d = 0; d < node->GetNDevices(); ++d) {
+                if (Ptr<CsmaNetDevice> csma = DynamicCast<CsmaNetDevice>(node->GetDevice(d))) stream += csma->AssignStreams(stream);
+            }
+        }
+        if (cfg.routing == "rip") stream += RipHelper().AssignStreams(topo.allNodes, stream);
+    };
+    assignInfrastructureStreams();
+
     // --- APLICACIONES ---
-    Time startTime = Seconds(10.0);
     ApplicationContainer sourceApps;
-    Ptr<WeibullRandomVariable> onTimeKplus = CreateObject<WeibullRandomVariable>();
-    onTimeKplus->SetAttribute("Scale", DoubleValue(300));
-    onTimeKplus->SetAttribute("Shape", DoubleValue(1.1));
-    Ptr<WeibullRandomVariable> onTimeKminus = CreateObject<WeibullRandomVariable>();
-    onTimeKminus->SetAttribute("Scale", DoubleValue(300));
-    onTimeKminus->SetAttribute("Shape", DoubleValue(0.9));
-    std::vector<Ptr<RandomVariableStream>> onTimeList = {onTimeKplus, onTimeKminus};
-    Ptr<ExponentialRandomVariable> offTime = CreateObject<ExponentialRandomVariable>();
-    offTime->SetAttribute("Mean", DoubleValue(6000));
+    int64_t sessionIdx = 0;
+    std::vector<Ptr<RandomVariableStream>> sessionVariables;
+    auto newOnTime = [&](double shape) {
+        Ptr<WeibullRandomVariable> onTime = CreateObject<WeibullRandomVariable>();
+        onTime->SetAttribute("Scale", DoubleValue(300));
+        onTime->SetAttribute("Shape", DoubleValue(shape));
+        onTime->SetAttribute("Antithetic", BooleanValue(cfg.antithetic));
+        onTime->SetStream(2 * sessionIdx);
+        sessionVariables.push_back(onTime);
+        return onTime;
+    };
+    auto newOffTime = [&]() {
+        Ptr<ExponentialRandomVariable> offTime = CreateObject<ExponentialRandomVariable>();
+        offTime->SetAttribute("Mean", DoubleValue(6000));
+        offTime->SetAttribute("Antithetic", BooleanValue(cfg.antithetic));
+        offTime->SetStream(2 * sessionIdx + 1);
+        sessionVariables.push_back(offTime);
+        return offTime;
+    };
     
-    if (num_usuarios_valencia > 0) {
-        PacketSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), 9)).Install(valenciaUsers).Start(startTime);
+    // Con serverApp=dash el servidor es un único DashServer y cada espectador un DashClient que
+    // pide segmentos con adaptación de calidad, hasta la tasa de su clase.
+    const uint16_t DASH_PORT = 80;
+    std::string dashLadder = cfg.dashLadder;
+    if (cfg.serverApp == "dash" && dashLadder.empty()) {
+        for (size_t c = 0; c < spec.classes.size(); ++c) dashLadder += (c ? "," : "") + std::to_string(spec.classes[c].rate.GetBitRate()) + "bps";
+    }
+    std::vector<Ptr<DashClient>> dashClients;
+    if (cfg.serverApp == "dash") {
+        Ptr<DashServer> dashServer = CreateObject<DashServer>();
+        dashServer->SetAttribute("Port", UintegerValue(DASH_PORT));
+        dashServer->SetAttribute("BitrateLadder", StringValue(dashLadder));
+        dashServer->SetAttribute("SegmentDuration", TimeValue(Seconds(cfg.dashSegment)));
+        server->AddApplication(dashServer);
+        sourceApps.Add(dashServer);
+    }
+
+    // Con serverApp=aggregated cada clase de tráfico de cada región la sirve un único
+    // MultiSessionServer; con onoff se instala un OnOffApplication por espectador.
+    auto newClassServer = [&](Ptr<Node> host) {
+        Ptr<MultiSessionServer> classServer;
+        if (cfg.serverApp == "aggregated") {
+            classServer = CreateObject<MultiSessionServer>();
+            host->AddApplication(classServer);
+            sourceApps.Add(classServer);
+        }
+        return classServer;
+    };
+
+    // --- CACHÉS DE BORDE (--edgeCache) ---
+    // Cada región tiene una caché en su router. Cada sesión ve un único título durante los 30 s
+    // de tráfico (los periodos on duran minutos); si la caché de su región lo tiene, la sesión
+    // la sirve el router de la región y no cruza el enlace router1 -> región. Las peticiones
+    // usan un flujo por región a partir de CONTENT_STREAM_BASE, por debajo de los de la
+    // infraestructura, así que los aciertos no dependen del bitrate.
+    const int64_t CONTENT_STREAM_BASE = (int64_t(1) << 32) - (int64_t(1) << 16);
+    ZipfCatalogue catalogue(cfg.edgeCache.capacity > 0 ? cfg.edgeCache.catalogue : 1, cfg.edgeCache.zipf);
+    uint32_t edgeSessions = 0, edgeHits = 0;
+
+    // Los periodos on alternan entre Weibull de forma 1.1 y 0.9, como en el modelo original
+    auto addSource = [&](Ptr<MultiSessionServer> classServer, const BuiltRegion& region, uint32_t user, DataRate rate, double onShape, bool atEdge) {
+        Ptr<RandomVariableStream> onTime = newOnTime(onShape);
+        Ptr<RandomVariableStream> offTime = newOffTime();
+        ++sessionIdx;
+        InetSocketAddress remote = region.SessionAddress(user);
+        // Una sesión servida por la caché sale del router de la región, por la dirección que ve su nodo
+        Ptr<Node> origin = atEdge ? region.router : server;
+        Ipv4Address originAddress = atEdge ? region.nodeGateways[user / region.sessionsPerNode] : serverAddress;
+        if (cfg.serverApp == "dash") {
+            Ptr<DashClient> client = CreateObject<DashClient>();
+            client->SetAttribute("Remote", AddressValue(InetSocketAddress(originAddress, DASH_PORT)));
+            client->SetAttribute("LocalPort", UintegerValue(remote.GetPort()));
+            client->SetAttribute("BitrateLadder", StringValue(dashLadder));
+            client->SetAttribute("SegmentDuration", TimeValue(Seconds(cfg.dashSegment)));
+            client->SetAttribute("MaxQuality", DataRateValue(rate));
+            client->SetAttribute("Algorithm", StringValue(cfg.dashAbr));
+            client->SetAttribute("OnTime", PointerValue(onTime));
+            client->SetAttribute("OffTime", PointerValue(offTime));
+            region.users.Get(user / region.sessionsPerNode)->AddApplication(client);
+            sourceApps.Add(client);
+            dashClients.push_back(client);
+            return;
+        }
+        if (classServer) { classServer->AddSession(remote, rate, onTime, offTime); return; }
+        OnOffHelper h("ns3::TcpSocketFactory", remote); h.SetAttribute("OnTime", PointerValue(onTime)); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(rate); sourceApps.Add(h.Install(origin));
+    };
+
+    // En cada región, una fracción activeFraction de los usuarios de cada clase recibe una
+    // sesión; las sesiones ocupan las primeras direcciones de la LAN, clase tras clase.
+    for (size_t r = 0; r < topo.regions.size(); ++r) {
+        const BuiltRegion& region = topo.regions[r];
+        if (region.numUsers == 0) continue;
+        // Un PacketSink por usuario: en los nodos agregados, uno por puerto de sesión
+        for (uint32_t k = 0; k < region.sessionsPerNode && region.router->GetSystemId() == rank && cfg.serverApp != "dash"; ++k) {
+            PacketSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), region.port + k)).Install(region.users).Start(startTime);
+        }
+        if (cfg.enableLogs) {
+            std::ostringstream perClass;
+            for (size_t c = 0; c < spec.classes.size(); ++c) perClass << (c ? ", " : "") << region.classUsers[c] * spec.activeFraction << " " << spec.classes[c].name;
+            NS_LOG_LOGIC("Creando aplicaciones para " << region.name << ": " << perClass.str() << ".");
+        }
+        if (!serverIsLocal) continue;
+        uint32_t regionSessions = 0;
+        for (size_t c = 0; c < spec.classes.size(); ++c) regionSessions += std::ceil(region.classUsers[c] * spec.activeFraction);
+        std::vector<bool> hits(regionSessions, false);
+        std::vector<Ptr<MultiSessionServer>> classServers, edgeServers;
+        if (cfg.edgeCache.capacity > 0) {
+            // La caché parte de su régimen estacionario: antes de las sesiones procesa 20
+            // peticiones por título que cabe en ella
+            Ptr<UniformRandomVariable> requests = CreateObject<UniformRandomVariable>();
+            requests->SetStream(CONTENT_STREAM_BASE + r);
+            hits = PlanEdgeHits(cfg.edgeCache, catalogue, regionSessions, 20 * uint64_t(cfg.edgeCache.capacity), [&requests]() { return requests->GetValue(); });
+            edgeSessions += regionSessions;
+            edgeHits += std::count(hits.begin(), hits.end(), true);
+            if (cfg.serverApp == "dash") {
+                Ptr<DashServer> edgeDash = CreateObject<DashServer>();
+                edgeDash->SetAttribute("Port", UintegerValue(DASH_PORT));
+                edgeDash->SetAttribute("BitrateLadder", StringValue(dashLadder));
+                edgeDash->SetAttribute("SegmentDuration", TimeValue(Seconds(cfg.dashSegment)));
+                region.router->AddApplication(edgeDash);
+                sourceApps.Add(edgeDash);
+            }
+            for (size_t c = 0; c < spec.classes.size(); ++c) edgeServers.push_back(newClassServer(region.router));
+        }
+        for (size_t c = 0; c < spec.classes.size(); ++c) classServers.push_back(newClassServer(server));
         uint32_t user_idx = 0;
-        if (enableLogs) {
-            NS_LOG_LOGIC("Creando aplicaciones para Valencia: " << (numValFHD * 0.4) << " FHD, " << (numValHD * 0.4) << " HD, " << (numValSD * 0.4) << " SD.");
+        for (size_t c = 0; c < spec.classes.size(); ++c) {
+            for (uint32_t i = 0; i < (region.classUsers[c] * spec.activeFraction); ++i, ++user_idx) {
+                bool atEdge = hits[user_idx];
+                addSource(atEdge ? edgeServers[c] : classServers[c], region, user_idx, spec.classes[c].rate, i % 2 ? 0.9 : 1.1, atEdge);
+            }
         }
-        for (uint32_t i = 0; i < (numValFHD * 0.4); ++i, ++user_idx) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(valenciaInterfaces.GetAddress(user_idx + 1), 9)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("800kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
-        for (uint32_t i = 0; i < (numValHD * 0.4); ++i, ++user_idx) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(valenciaInterfaces.GetAddress(user_idx + 1), 9)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("500kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
-        for (uint32_t i = 0; i < (numValSD * 0.4); ++i, ++user_idx) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(valenciaInterfaces.GetAddress(user_idx + 1), 9)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("200kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
     }
-    
-    if (num_usuarios_baleares > 0) {
-        PacketSinkHelper("ns3::TcpSocketFactory", InetSocketAddress(Ipv4Address::GetAny(), 10)).Install(balearesUsers).Start(startTime);
-        uint32_t user_idx_bal = 0;
-        if (enableLogs) {
-            NS_LOG_LOGIC("Creando aplicaciones para Baleares: " << (numBalFHD * 0.4) << " FHD, " << (numBalHD * 0.4) << " HD, " << (numBalSD * 0.4) << " SD.");
-        }
-        for (uint32_t i = 0; i < (numBalFHD * 0.4); ++i, ++user_idx_bal) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(balearesInterfaces.GetAddress(user_idx_bal + 1), 10)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("800kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
-        for (uint32_t i = 0; i < (numBalHD * 0.4); ++i, ++user_idx_bal) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(balearesInterfaces.GetAddress(user_idx_bal + 1), 10)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("500kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
-        for (uint32_t i = 0; i < (numBalSD * 0.4); ++i, ++user_idx_bal) { OnOffHelper h("ns3::TcpSocketFactory", InetSocketAddress(balearesInterfaces.GetAddress(user_idx_bal + 1), 10)); h.SetAttribute("OnTime", PointerValue(onTimeList[i % 2])); h.SetAttribute("OffTime", PointerValue(offTime)); h.SetConstantRate(DataRate("200kb/s")); sourceApps.Add(h.Install(serverNode.Get(0))); }
+    double edgeHitRatio = edgeSessions > 0 ? double(edgeHits) / edgeSessions : 0;
+    if (cfg.edgeCache.capacity > 0 && cfg.enableLogs) {
+        NS_LOG_INFO("Cachés de borde: " << edgeHits << " de " << edgeSessions << " sesiones servidas desde el router de su región.");
     }
 
     sourceApps.Start(startTime);
-    sourceApps.Stop(Seconds(40.0));
+    sourceApps.Stop(appStopTime);
 
     // --- SIMULACIÓN Y RECOLECCIÓN DE DATOS ---
+    Ptr<FlowMonitor> flowmon;
     FlowMonitorHelper flowmonHelper;
-    Ptr<FlowMonitor> flowmon = flowmonHelper.InstallAll();
+    std::unique_ptr<QosProbe> probe;
+    if (cfg.metrics == "probe") {
+        probe = std::make_unique<QosProbe>(server, serverAddress, topo.totalUsers);
+        for (const auto& region : topo.regions) {
+            if (region.numUsers > 0) probe->AddUsers(region.users, region.nodeAddresses[0], region.nodeAddressStride, region.sessionsPerNode, region.port, region.numUsers);
+            if (region.numUsers > 0 && cfg.edgeCache.capacity > 0) probe->AddEdgeServer(region.router);
+        }
+    } else {
+        flowmon = flowmonHelper.InstallAll();
+    }
+
+    // Serie temporal de la cola de router1 hacia el primer enlace 'bottleneck' (opcional)
+    std::unique_ptr<BottleneckQueueMonitor> queueMonitor;
+    if (!cfg.queueTrace.empty()) {
+        NS_ABORT_MSG_IF(topo.bottleneckDevices.GetN() == 0, "--queueTrace necesita un enlace 'bottleneck' en la topología");
+        queueMonitor = std::make_unique<BottleneckQueueMonitor>(DynamicCast<CsmaNetDevice>(topo.bottleneckDevices.Get(0)), bottleneckRate, Seconds(cfg.queueTraceInterval), simStopTime);
+    }
+
+    // Flujos de los usuarios con FlowMonitor: del servidor o, con cachés de borde, del router de la
+    // región, a la dirección y el puerto de la sesión de un usuario. Así no cuentan como usuarios
+    // otros flujos del mismo origen, como los anuncios de RIP (UDP 520).
+    std::set<Ipv4Address> origins = {serverAddress};
+    std::set<std::pair<Ipv4Address, uint16_t>> sessions;
+    for (const auto& region : topo.regions) {
+        if (cfg.edgeCache.capacity > 0) origins.insert(region.nodeGateways.begin(), region.nodeGateways.end());
+        for (uint32_t user = 0; user < region.numUsers; ++user) {
+            InetSocketAddress session = region.SessionAddress(user);
+            sessions.insert({session.GetIpv4(), session.GetPort()});
+        }
+    }
+    Ptr<Ipv4FlowClassifier> classifier = flowmon ? DynamicCast<Ipv4FlowClassifier>(flowmonHelper.GetClassifier()) : nullptr;
+    auto isUserFlow = [&](FlowId flowId) {
+        Ipv4FlowClassifier::FiveTuple flow = classifier->FindFlow(flowId);
+        return flow.protocol == 6 && origins.count(flow.sourceAddress) > 0 && sessions.count({flow.destinationAddress, flow.destinationPort}) > 0;
+    };
+
+    // Análisis de salida: métricas por intervalo, transitorio y parada de la réplica (ver output-analysis.h)
+    std::unique_ptr<OutputAnalyzer> analyzer;
+    if (cfg.earlyStop || cfg.warmup || cfg.runPrecision > 0 || !cfg.intervalTrace.empty()) {
+        OutputAnalyzer::Sampler sampler;
+        OutputAnalyzer::SketchSampler sketchSampler;
+        if (probe) {
+            sampler = [&probe](std::vector<FlowCounters>& flows) {
+                flows.resize(probe->FlowCount());
+                for (uint32_t f = 0; f < flows.size(); ++f) probe->FlowTotals(f, flows[f].txPackets, flows[f].rxPackets, flows[f].delaySumS, flows[f].jitterSumS);
+            };
+            sketchSampler = [&probe](LatencySketch& delay, LatencySketch& jitter) { probe->Sketches(delay, jitter); };
+        } else {
+            sampler = [&flowmon](std::vector<FlowCounters>& flows) {
+                for (auto const& [flowId, flowStats] : flowmon->GetFlowStats()) {
+                    if (flowId > flows.size()) flows.resize(flowId); // Los FlowId empiezan en 1
+                    flows[flowId - 1] = {flowStats.txPackets, flowStats.rxPackets, flowStats.delaySum.GetSeconds(), flowStats.jitterSum.GetSeconds()};
+                }
+            };
+            sketchSampler = [&flowmon, &isUserFlow](LatencySketch& delay, LatencySketch& jitter) {
+                delay = LatencySketch();
+                jitter = LatencySketch();
+                for (auto const& [flowId, flowStats] : flowmon->GetFlowStats()) {
+                    if (!isUserFlow(flowId)) continue;
+                    delay.Merge(SketchFromHistogram(flowStats.delayHistogram));
+                    jitter.Merge(SketchFromHistogram(flowStats.jitterHistogram));
+                }
+            };
+        }
+        OutputAnalysisConfig analysis{Seconds(cfg.analysisWindow), cfg.analysisMinWindows, cfg.earlyStop, cfg.warmup, cfg.runPrecision};
+        analyzer = std::make_unique<OutputAnalyzer>(sampler, sketchSampler, startTime, appStopTime, analysis);
+    }
 
-    Simulator::Stop(Seconds(45.0));
+    // Paquetes que cruzan el cuello de botella, para medir el coste de la simulación
+    uint64_t bottleneckPackets = 0;
+    if (topo.bottleneckDevices.GetN() > 0) {
+        topo.bottleneckDevices.Get(0)->TraceConnectWithoutContext("PhyTxEnd", MakeBoundCallback(&CountPacket, &bottleneckPackets));
+    }
+
+    // --- INSTANTÁNEA: EL ESCENARIO SE CONSTRUYE UNA VEZ POR NÚMERO DE USUARIOS ---
+    // Con RIP la red converge aquí, antes del tráfico. Cada hijo pone su bitrate en los
+    // enlaces 'bottleneck' y vuelve a sembrar todas las variables con su ejecución.
+    if (plan) {
+        if (startTime.IsStrictlyPositive()) {
+            Simulator::Stop(startTime);
+            Simulator::Run();
+        }
+        ForkFromSnapshot(*plan);
+        wallStart = std::chrono::steady_clock::now();
+        const ReplicaConfig& task = plan->tasks[plan->current];
+        cfg.bitrateMbps = task.bitrateMbps;
+        cfg.run = task.run;
+        cfg.antithetic = task.antithetic;
+        bottleneckRate = DataRate(static_cast<uint64_t>(cfg.bitrateMbps * 1e6));
+        SetBottleneckRate(topo, bottleneckRate);
+        if (bottleneckQdisc && bottleneckQdisc->GetInstanceTypeId().GetName() == "ns3::RedQueueDisc" && cfg.qdisc.find("LinkBandwidth") == std::string::npos) {
+            bottleneckQdisc->SetAttribute("LinkBandwidth", DataRateValue(bottleneckRate));
+        }
+        RngSeedManager::SetRun(cfg.run);
+        assignInfrastructureStreams();
+        for (const auto& variable : sessionVariables) {
+            variable->SetAttribute("Antithetic", BooleanValue(cfg.antithetic));
+            variable->SetStream(variable->GetStream());
+        }
+    }
+
+    Simulator::Stop(simStopTime - Simulator::Now());
     Simulator::Run();
+    double simSeconds = Simulator::Now().GetSeconds();
+    uint64_t events = Simulator::GetEventCount();
+    OutputAnalyzer::Stop stop = analyzer ? analyzer->StopReason() : OutputAnalyzer::RAN_TO_END;
+    if (stop != OutputAnalyzer::RAN_TO_END && cfg.enableLogs) {
+        NS_LOG_INFO("Réplica detenida en t=" << simSeconds << " s: "
+                    << (stop == OutputAnalyzer::PRECISION_REACHED ? "precisión alcanzada" : stop == OutputAnalyzer::QOS_MET ? "cumple la QoS" : "no cumple la QoS") << ".");
+    }
+
+#ifdef NS3_MPI
+    if (cfg.mpiRanks > 1) probe->ReduceToRoot(MpiInterface::GetCommunicator());
+#endif
 
-    Average<double> avgDelay, avgJitter;
-    double totalTxPackets = 0, totalLostPackets = 0;
-    for (auto const& [flowId, flowStats] : flowmon->GetFlowStats()) {
-        if (flowStats.txPackets > 10) {
-            totalTxPackets += flowStats.txPackets;
-            totalLostPackets += flowStats.lostPackets;
-            if (flowStats.rxPackets > 0) avgDelay.Update((flowStats.delaySum.GetSeconds() / flowStats.rxPackets) * 1000);
-            if (flowStats.rxPackets > 1) avgJitter.Update(flowStats.jitterSum.GetSeconds() / (flowStats.rxPackets - 1) * 1000);
+    if (queueMonitor) {
+        std::ostringstream traceName;
+        traceName << cfg.queueTrace << "-" << cfg.numUsuarios << "u-" << cfg.bitrateMbps << "Mbps-" << cfg.semilla << "-" << cfg.run << (cfg.antithetic ? "a" : "") << ".qts";
+        queueMonitor->Write(traceName.str(), cfg.numUsuarios, cfg.bitrateMbps, cfg.semilla, cfg.run);
+    }
+
+    double lossRatio = 0, delayMs = 0, jitterMs = 0;
+    if (rank != 0) {
+        // Las métricas solo se calculan en el proceso 0, con los contadores ya sumados
+    } else if (analyzer && analyzer->Metrics(lossRatio, delayMs, jitterMs)) {
+        // --warmup: solo los contadores posteriores al transitorio
+    } else if (probe) {
+        probe->Compute(lossRatio, delayMs, jitterMs);
+    } else {
+        Average<double> avgDelay, avgJitter;
+        double totalTxPackets = 0, totalLostPackets = 0;
+        for (auto const& [flowId, flowStats] : flowmon->GetFlowStats()) {
+            if (flowStats.txPackets > 10) {
+                totalTxPackets += flowStats.txPackets;
+                totalLostPackets += flowStats.lostPackets;
+                if (flowStats.rxPackets > 0) avgDelay.Update((flowStats.delaySum.GetSeconds() / flowStats.rxPackets) * 1000);
+                if (flowStats.rxPackets > 1) avgJitter.Update(flowStats.jitterSum.GetSeconds() / (flowStats.rxPackets - 1) * 1000);
+            }
         }
+        lossRatio = (totalTxPackets > 0) ? (totalLostPackets / totalTxPackets * 100) : 0;
+        delayMs = avgDelay.Mean();
+        jitterMs = avgJitter.Mean();
     }
-    double lossRatio = (totalTxPackets > 0) ? (totalLostPackets / totalTxPackets * 100) : 0;
     
-    std::ofstream outFile("results.dat", std::ios::app);
-    outFile << num_usuarios << " " << bitrate_val << " " << lossRatio << " " << avgDelay.Mean() << " " << avgJitter.Mean() << std::endl;
-    outFile.close();
+    // Distribución de la QoS entre los usuarios: un flujo servidor -> usuario por usuario. Con
+    // --warmup, como las métricas medias, sin los paquetes del transitorio: a cada usuario se le
+    // restan sus contadores al final del transitorio y a los percentiles, los histogramas de entonces.
+    UserQosStats userQos;
+    if (rank == 0) {
+        // Como las métricas medias, solo en el proceso 0
+        std::vector<FlowCounters> transient;
+        LatencySketch transientDelay, transientJitter;
+        if (analyzer) analyzer->Transient(transient, transientDelay, transientJitter);
+        UserQosSummary summary;
+        if (probe) {
+            summary = probe->UserQos(transient);
+        } else {
+            for (auto const& [flowId, flowStats] : flowmon->GetFlowStats()) {
+                if (!isUserFlow(flowId)) continue;
+                FlowCounters now{flowStats.txPackets, flowStats.rxPackets, flowStats.delaySum.GetSeconds(), flowStats.jitterSum.GetSeconds()};
+                summary.AddUser(now, flowId - 1 < transient.size() ? transient[flowId - 1] : FlowCounters(), SketchFromHistogram(flowStats.delayHistogram), SketchFromHistogram(flowStats.jitterHistogram));
+            }
+        }
+        summary.RemovePackets(transientDelay, transientJitter);
+        userQos = summary.Result();
+    }
+
+    double warmupSeconds = analyzer ? analyzer->WarmupSeconds() : 0;
+    if (analyzer && !cfg.intervalTrace.empty()) {
+        std::ostringstream intervalName;
+        intervalName << cfg.intervalTrace << "-" << cfg.numUsuarios << "u-" << cfg.bitrateMbps << "Mbps-" << cfg.semilla << "-" << cfg.run << (cfg.antithetic ? "a" : "") << ".int";
+        analyzer->Write(intervalName.str());
+    }
+
+    DashClientStats dash;
+    for (const auto& client : dashClients) dash.Add(client->GetStats());
+    if (!dashClients.empty() && cfg.enableLogs) {
+        NS_LOG_INFO("Clientes DASH: " << dash.sessions << " sesiones, " << dash.started << " con reproducción, " << dash.stalls << " paradas.");
+    }
+
+    if (profiler) {
+        std::ostringstream profileName;
+        profileName << cfg.profile << "-" << cfg.numUsuarios << "u-" << cfg.bitrateMbps << "Mbps-" << cfg.run;
+        profiler->Report(profileName.str(), cfg.profileTop);
+    }
+
+    if (bottleneckQdisc && cfg.enableLogs) {
+        NS_LOG_INFO("Disciplina de cola " << cfg.qdisc << " en el cuello de botella:\n" << bottleneckQdisc->GetStats());
+    }
 
     Simulator::Destroy();
-    
+
     // Este log de resumen final se imprime siempre para poder seguir el progreso.
-    NS_LOG_INFO("Fin de la réplica. Resumen -> Usuarios: " << num_usuarios << ", Bitrate: " << bitrate_str << ", Delay: " << avgDelay.Mean() << " ms, Jitter: " << avgJitter.Mean() << " ms, Pérdidas: " << lossRatio << " %");
-    
+    if (rank == 0) NS_LOG_INFO("Fin de la réplica. Resumen -> Usuarios: " << cfg.numUsuarios << ", Bitrate: " << cfg.bitrateMbps << "Mbps, Delay: " << delayMs << " ms, Jitter: " << jitterMs << " ms, Pérdidas: " << lossRatio << " %, Usuarios que cumplen: " << userQos.usersOk * 100 << " %, P95 del retardo: " << userQos.delayP95Ms << " ms"
+                            << (cfg.edgeCache.capacity > 0 ? ", Aciertos de las cachés de borde: " + std::to_string(edgeHitRatio * 100) + " %" : "")
+                            << (dashClients.empty() ? "" : ", Arranque: " + std::to_string(dash.StartupDelay()) + " s, Rebuffering: " + std::to_string(dash.RebufferRatio() * 100) + " %, Bitrate medio: " + std::to_string(dash.AverageBitrateKbps()) + " kbps"));
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    return {cfg.numUsuarios, cfg.bitrateMbps, lossRatio, delayMs, jitterMs, wallSeconds, usage.ru_maxrss,
+            dash.StartupDelay(), dash.RebufferRatio() * 100, dash.AverageBitrateKbps(), simSeconds, events, bottleneckPackets,
+            stop == OutputAnalyzer::QOS_MET || stop == OutputAnalyzer::QOS_FAILED, stop == OutputAnalyzer::PRECISION_REACHED, warmupSeconds, userQos, edgeHitRatio};
+}
+
+// Versión del modelo: cambiarla cada vez que una modificación del código altere los resultados,
+// para que los registros de results.bin generados con el código anterior se distingan.
+const char* MODEL_VERSION = "onoffRouting-3";
+
+// Descripción canónica de todos los parámetros del modelo que afectan al resultado, salvo
+// usuarios, bitrate, semilla y ejecución, que se guardan aparte en cada registro.
+std::string
+ModelDescription(const ReplicaConfig& cfg)
+{
+    std::ostringstream desc, topology;
+    topology << cfg.topology;
+    desc << MODEL_VERSION << ";serverApp=" << cfg.serverApp << ";metrics=" << cfg.metrics << ";routing=" << cfg.routing << ";topology=" << Fnv1a64(topology.str());
+    if (cfg.mpiRanks > 1)
+    {
+        desc << ";distributed"; // Enlaces de región punto a punto en lugar de CSMA
+    }
+    if (cfg.serverApp == "dash")
+    {
+        desc << ";dash=" << cfg.dashLadder << "," << cfg.dashSegment << "s," << cfg.dashAbr;
+    }
+    if (!cfg.qdisc.empty())
+    {
+        desc << ";qdisc=" << cfg.qdisc << ";deviceQueue=" << cfg.deviceQueue;
+    }
+    if (cfg.snapshot && cfg.routing == "rip")
+    {
+        desc << ";snapshot"; // Todas las réplicas de un número de usuarios parten de la misma convergencia de RIP
+    }
+    if (cfg.earlyStop || cfg.warmup || cfg.runPrecision > 0)
+    {
+        // Métricas parciales o sin el transitorio
+        desc << ";analysis=" << cfg.analysisWindow << "s," << cfg.analysisMinWindows << (cfg.earlyStop ? ",earlyStop" : "")
+             << (cfg.warmup ? ",mser" : "");
+        if (cfg.runPrecision > 0)
+        {
+            desc << ",precision=" << cfg.runPrecision;
+        }
+    }
+    if (!cfg.tcp.IsDefault())
+    {
+        desc << ";tcp=" << cfg.tcp;
+    }
+    if (cfg.edgeCache.capacity > 0)
+    {
+        desc << ";edgeCache=" << cfg.edgeCache.capacity << "," << cfg.edgeCache.catalogue << "," << cfg.edgeCache.zipf << "," << cfg.edgeCache.policy;
+    }
+    return desc.str();
+}
+
+uint64_t
+ConfigHash(const ReplicaConfig& cfg)
+{
+    return Fnv1a64(ModelDescription(cfg));
+}
+
+// Añade la réplica al fichero de resultados. Si el nombre acaba en ".dat" se usa el formato
+// de texto anterior; si no, el almacén binario de results-store.h, seguro con varios escritores.
+void
+AppendResult(const std::string& fileName, const ReplicaConfig& cfg, const ReplicaResult& r)
+{
+    if (fileName.size() >= 4 && fileName.compare(fileName.size() - 4, 4, ".dat") == 0)
+    {
+        std::ofstream outFile(fileName, std::ios::app);
+        outFile << r.numUsuarios << " " << r.bitrateMbps << " " << r.lossRatio << " " << r.delayMs << " " << r.jitterMs << std::endl;
+        outFile.close();
+        return;
+    }
+    // Una vez por fichero y configuración en cada proceso: el catálogo <fichero>.configs
+    static std::set<std::pair<std::string, uint64_t>> registered;
+    uint64_t configHash = ConfigHash(cfg);
+    if (registered.insert({fileName, configHash}).second)
+    {
+        RegisterConfig(fileName, configHash, ModelDescription(cfg));
+    }
+    ResultRecord record{};
+    record.users = r.numUsuarios;
+    record.seed = cfg.semilla;
+    record.run = cfg.run;
+    record.flags = (cfg.antithetic ? RESULT_FLAG_ANTITHETIC : 0) | (r.earlyStop ? RESULT_FLAG_EARLY_STOP : 0) |
+                   (r.precisionStop ? RESULT_FLAG_PRECISION_STOP : 0);
+    record.bitrateMbps = r.bitrateMbps;
+    record.lossRatio = r.lossRatio;
+    record.delayMs = r.delayMs;
+    record.jitterMs = r.jitterMs;
+    record.wallSeconds = r.wallSeconds;
+    record.configHash = configHash;
+    record.unixTime = std::time(nullptr);
+    record.startupDelayS = r.startupDelayS;
+    record.rebufferRatio = r.rebufferRatio;
+    record.avgBitrateKbps = r.avgBitrateKbps;
+    record.usersDelayOk = r.users.usersDelayOk;
+    record.usersJitterOk = r.users.usersJitterOk;
+    record.usersLossOk = r.users.usersLossOk;
+    record.usersOk = r.users.usersOk;
+    record.delayP50Ms = r.users.delayP50Ms;
+    record.delayP95Ms = r.users.delayP95Ms;
+    record.delayP99Ms = r.users.delayP99Ms;
+    record.jitterP95Ms = r.users.jitterP95Ms;
+    record.edgeHitRatio = r.edgeHitRatio;
+    if (!AppendResultRecord(fileName, record))
+    {
+        std::cerr << "Aviso: no se pudo añadir la réplica a " << fileName << ": "
+                  << (errno == EPROTO ? "el fichero es de otra versión del esquema" : std::strerror(errno)) << std::endl;
+    }
+}
+
+// --- CACHÉ DE RÉPLICAS (--cacheFile) ---
+// Almacén binario que conserva las réplicas de todos los barridos anteriores. La clave de una
+// réplica es el hash de la configuración (ConfigHash: MODEL_VERSION, topología y demás
+// parámetros del modelo) junto con usuarios, bitrate, semilla, ejecución y si es antitética.
+// Dos réplicas con la misma clave dan el mismo resultado, así que la que ya está en la caché
+// se toma de ella sin simularla. Ampliar el barrido (más usuarios, más réplicas) solo simula
+// lo nuevo.
+class ReplicaCache
+{
+  public:
+    explicit ReplicaCache(const std::string& fileName)
+    {
+        MappedResults results(fileName);
+        for (size_t i = 0; i < results.Size(); ++i)
+        {
+            ResultRecord r = results[i];
+            m_records[{r.configHash, r.users, r.bitrateMbps, r.seed, r.run, r.flags & RESULT_FLAG_ANTITHETIC}] = r;
+        }
+    }
+
+    bool Find(const ReplicaConfig& cfg, ReplicaResult& result) const
+    {
+        uint32_t flags = cfg.antithetic ? RESULT_FLAG_ANTITHETIC : 0;
+        auto it = m_records.find({ConfigHash(cfg), cfg.numUsuarios, cfg.bitrateMbps, cfg.semilla, cfg.run, flags});
+        if (it == m_records.end())
+        {
+            return false;
+        }
+        const ResultRecord& r = it->second;
+        result = {r.users, r.bitrateMbps, r.lossRatio, r.delayMs, r.jitterMs, r.wallSeconds, 0,
+                  r.startupDelayS, r.rebufferRatio, r.avgBitrateKbps, 0, 0, 0,
+                  (r.flags & RESULT_FLAG_EARLY_STOP) != 0, (r.flags & RESULT_FLAG_PRECISION_STOP) != 0, 0,
+                  {r.usersDelayOk, r.usersJitterOk, r.usersLossOk, r.usersOk, r.delayP50Ms, r.delayP95Ms, r.delayP99Ms, r.jitterP95Ms},
+                  r.edgeHitRatio};
+        return true;
+    }
+
+    size_t Size() const
+    {
+        return m_records.size();
+    }
+
+  private:
+    // (configHash, usuarios, bitrate, semilla, ejecución, antitética)
+    std::map<std::tuple<uint64_t, uint32_t, double, uint32_t, uint32_t, uint32_t>, ResultRecord> m_records;
+};
+
+// --- POOL DE PROCESOS PARA EL BARRIDO ---
+// Cada réplica se ejecuta en un hijo creado con fork(): el Simulator es un singleton global,
+// así que aislarlo en su propio proceso permite ejecutar tantas réplicas a la vez como núcleos.
+// El registro de tipos de ns-3 y el arranque del proceso se pagan una sola vez en el padre.
+// El hijo devuelve su ReplicaResult por una tubería y el padre llama a onResult en cuanto llega.
+void
+RunReplicaPool(const std::vector<ReplicaConfig>& tasks,
+               uint32_t jobs,
+               const std::function<void(size_t, const ReplicaResult&)>& onResult)
+{
+    if (jobs == 0)
+    {
+        jobs = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    struct Worker
+    {
+        size_t taskIdx;
+        int fd;
+    };
+    std::map<pid_t, Worker> workers;
+    size_t next = 0;
+
+    while (next < tasks.size() || !workers.empty())
+    {
+        while (next < tasks.size() && workers.size() < jobs)
+        {
+            int fds[2];
+            if (pipe(fds) != 0)
+            {
+                NS_FATAL_ERROR("No se pudo crear la tubería para el hijo: " << std::strerror(errno));
+            }
+            std::cout.flush();
+            std::cerr.flush();
+            pid_t pid = fork();
+            if (pid < 0)
+            {
+                NS_FATAL_ERROR("fork() ha fallado: " << std::strerror(errno));
+            }
+            if (pid == 0)
+            {
+                close(fds[0]);
+                ReplicaResult r = RunReplica(tasks[next]);
+                ssize_t n = write(fds[1], &r, sizeof(r));
+                close(fds[1]);
+                _exit(n == sizeof(r) ? 0 : 1);
+            }
+            close(fds[1]);
+            workers[pid] = {next, fds[0]};
+            ++next;
+        }
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            NS_FATAL_ERROR("waitpid() ha fallado: " << std::strerror(errno));
+        }
+        auto it = workers.find(pid);
+        if (it == workers.end())
+        {
+            continue;
+        }
+        ReplicaResult r;
+        ssize_t n = read(it->second.fd, &r, sizeof(r));
+        close(it->second.fd);
+        const ReplicaConfig& task = tasks[it->second.taskIdx];
+        if (WIFEXITED(status) && WEXITSTATUS(status) == 0 && n == sizeof(r))
+        {
+            onResult(it->second.taskIdx, r);
+        }
+        else
+        {
+            std::cerr << "Aviso: la réplica (usuarios=" << task.numUsuarios << ", bitrate=" << task.bitrateMbps
+                      << "Mbps, ejecución=" << task.run << ") ha terminado con error y se descarta." << std::endl;
+        }
+        workers.erase(it);
+    }
+}
+
+// Variante del pool con --snapshot: las réplicas se agrupan por número de usuarios y cada
+// grupo lo ejecuta un proceso que construye el escenario una sola vez y crea desde él un hijo
+// por réplica (RunReplica con SnapshotPlan). Los hijos escriben {réplica, resultado} en la
+// tubería común; cada registro ocupa menos de PIPE_BUF bytes, así que write() es atómico y los
+// registros de varios hijos no se entremezclan.
+void
+RunSnapshotPool(const std::vector<ReplicaConfig>& tasks,
+                uint32_t jobs,
+                const std::function<void(size_t, const ReplicaResult&)>& onResult)
+{
+    struct SnapshotResult
+    {
+        uint64_t task; // Índice dentro del grupo
+        ReplicaResult result;
+    };
+    static_assert(sizeof(SnapshotResult) <= PIPE_BUF, "SnapshotResult debe caber en una escritura atómica");
+
+    std::map<uint32_t, std::vector<size_t>> groups;
+    for (size_t t = 0; t < tasks.size(); ++t)
+    {
+        groups[tasks[t].numUsuarios].push_back(t);
+    }
+    for (const auto& [users, group] : groups)
+    {
+        SnapshotPlan plan{{}, jobs};
+        for (size_t t : group)
+        {
+            plan.tasks.push_back(tasks[t]);
+        }
+        int fds[2];
+        if (pipe(fds) != 0)
+        {
+            NS_FATAL_ERROR("No se pudo crear la tubería para la instantánea: " << std::strerror(errno));
+        }
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t builder = fork();
+        if (builder < 0)
+        {
+            NS_FATAL_ERROR("fork() ha fallado: " << std::strerror(errno));
+        }
+        if (builder == 0)
+        {
+            close(fds[0]);
+            SnapshotResult out{0, RunReplica(plan.tasks[0], &plan)};
+            out.task = plan.current;
+            ssize_t n = write(fds[1], &out, sizeof(out));
+            _exit(n == sizeof(out) ? 0 : 1);
+        }
+        close(fds[1]);
+
+        std::vector<bool> received(group.size(), false);
+        SnapshotResult in;
+        while (true)
+        {
+            ssize_t n = read(fds[0], &in, sizeof(in));
+            if (n < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if (n != sizeof(in))
+            {
+                break;
+            }
+            if (in.task < group.size() && !received[in.task])
+            {
+                received[in.task] = true;
+                onResult(group[in.task], in.result);
+            }
+        }
+        close(fds[0]);
+        while (waitpid(builder, nullptr, 0) < 0 && errno == EINTR)
+        {
+        }
+        for (size_t i = 0; i < group.size(); ++i)
+        {
+            if (!received[i])
+            {
+                const ReplicaConfig& task = tasks[group[i]];
+                std::cerr << "Aviso: la réplica (usuarios=" << task.numUsuarios << ", bitrate=" << task.bitrateMbps
+                          << "Mbps, ejecución=" << task.run << ") ha terminado con error y se descarta." << std::endl;
+            }
+        }
+    }
+}
+
+// Ejecución (RngSeedManager::SetRun) de la réplica i de un punto. El antiguo criterio de
+// run.sh (semilla = usuarios + bitrate + i) repetía semillas entre puntos y entre réplicas de
+// un mismo punto (p. ej. 10 Mbps réplica 11 y 20 Mbps réplica 1). Con números aleatorios
+// comunes (rng=crn) la réplica i usa la ejecución i en todos los puntos, de modo que las
+// diferencias entre bitrates no se deben al azar; con rng=independent cada punto tiene sus
+// propias ejecuciones, derivadas de un hash de (usuarios, bitrate, i).
+uint32_t
+ReplicaRun(uint32_t users, double bitrateMbps, uint32_t i, const std::string& rng)
+{
+    if (rng == "crn")
+    {
+        return i;
+    }
+    std::ostringstream key;
+    key << users << ":" << bitrateMbps << ":" << i;
+    return static_cast<uint32_t>(Fnv1a64(key.str()) % 0xFFFFFFFEu) + 1;
+}
+
+// --- REPLICACIÓN SECUENCIAL ---
+// Número de réplicas por punto. Con minReplicas == maxReplicas es fijo; si no, se añaden
+// réplicas a un punto hasta que el IC del 95% de las tres métricas es más estrecho que
+// ciRelative * max(|media|, umbral de QoS) o que ciAbsolute (ms para retardo y jitter, % para
+// pérdidas). El umbral evita que una media casi nula (pocas pérdidas) pida un semiancho
+// inalcanzable y lleve todos los puntos holgados hasta maxReplicas.
+struct ReplicationConfig
+{
+    uint32_t minReplicas;
+    uint32_t maxReplicas;
+    double ciRelative;
+    double ciAbsolute;
+    uint32_t jobs;
+    std::string resultsFile;
+    std::string rng;     // "crn" (números aleatorios comunes entre bitrates) o "independent"
+    bool antithetic;     // Réplicas por parejas antitéticas; cada pareja cuenta como una muestra
+    ReplicaConfig model; // Parámetros del modelo comunes a todas las réplicas
+    std::string cacheFile;                     // Vacío = sin caché de réplicas
+    std::shared_ptr<const ReplicaCache> cache; // Contenido de cacheFile al empezar
+};
+
+// Muestras acumuladas de un punto (usuarios, bitrate)
+struct PointState
+{
+    uint32_t users;
+    double bitrate;
+    uint32_t launched; // Réplicas lanzadas; fija el índice de la siguiente ejecución
+    std::vector<double> loss;
+    std::vector<double> delay;
+    std::vector<double> jitter;
+    std::map<uint32_t, ReplicaResult> halfPairs; // Con --antithetic: mitades esperando a su pareja
+};
+
+// Medias e IC del 95% de un punto
+struct PointSummary
+{
+    uint32_t replicas;
+    double lossMean;
+    double lossMarginOfError;
+    double delayMean;
+    double delayMarginOfError;
+    double jitterMean;
+    double jitterMarginOfError;
+    bool passes;
+};
+
+PointSummary
+Summarize(const PointState& p)
+{
+    PointSummary s;
+    s.replicas = p.delay.size();
+    s.lossMean = CalculateMean(p.loss);
+    s.lossMarginOfError = CalculateMarginOfError(CalculateStdDev(p.loss, s.lossMean), s.replicas);
+    s.delayMean = CalculateMean(p.delay);
+    s.delayMarginOfError = CalculateMarginOfError(CalculateStdDev(p.delay, s.delayMean), s.replicas);
+    s.jitterMean = CalculateMean(p.jitter);
+    s.jitterMarginOfError = CalculateMarginOfError(CalculateStdDev(p.jitter, s.jitterMean), s.replicas);
+    s.passes = MeetsQos(s.delayMean, s.jitterMean, s.lossMean);
+    return s;
+}
+
+// Réplicas que hay que añadir a un punto para alcanzar la precisión pedida (0 si ya la tiene).
+// El tamaño necesario se estima con la desviación y el cuantil t actuales, de modo que los
+// puntos ruidosos (cerca de la saturación) reciben varias réplicas por ronda.
+uint32_t
+ExtraReplicasNeeded(const PointState& p, const ReplicationConfig& rc)
+{
+    if (p.launched < rc.minReplicas)
+    {
+        return rc.minReplicas - p.launched;
+    }
+    if (p.launched >= rc.maxReplicas)
+    {
+        return 0;
+    }
+    uint32_t n = p.delay.size();
+    if (n < 2)
+    {
+        return 1;
+    }
+    uint32_t needed = 0;
+    const std::pair<const std::vector<double>*, double> metrics[] = {
+        {&p.loss, MAX_LOSS_PERCENT}, {&p.delay, MAX_DELAY_MS}, {&p.jitter, MAX_JITTER_MS}};
+    for (const auto& [samples, threshold] : metrics)
+    {
+        double mean = CalculateMean(*samples);
+        double stdDev = CalculateStdDev(*samples, mean);
+        double target = std::max(rc.ciAbsolute, rc.ciRelative * std::max(std::abs(mean), threshold));
+        if (CalculateMarginOfError(stdDev, n) <= target)
+        {
+            continue;
+        }
+        uint32_t estimate = rc.maxReplicas;
+        if (target > 0)
+        {
+            estimate = static_cast<uint32_t>(std::ceil(std::pow(StudentT975(n - 1) * stdDev / target, 2)));
+        }
+        needed = std::max(needed, std::max(estimate, n + 1));
+    }
+    if (needed == 0)
+    {
+        return 0;
+    }
+    uint32_t target = std::min(needed, rc.maxReplicas);
+    return target > p.launched ? target - p.launched : 1;
+}
+
+// Lanza réplicas por rondas hasta que todos los puntos alcanzan la precisión o maxReplicas.
+// Cada ronda reparte las réplicas pendientes de todos los puntos en el mismo pool.
+void
+RunPoints(std::vector<PointState>& points, const ReplicationConfig& rc)
+{
+    uint32_t round = 0;
+    while (true)
+    {
+        std::vector<ReplicaConfig> tasks;
+        std::vector<size_t> owner;
+        for (size_t idx = 0; idx < points.size(); ++idx)
+        {
+            PointState& p = points[idx];
+            uint32_t extra = ExtraReplicasNeeded(p, rc);
+            for (uint32_t k = 0; k < extra; ++k)
+            {
+                ++p.launched;
+                ReplicaConfig task = rc.model;
+                task.numUsuarios = p.users;
+                task.bitrateMbps = p.bitrate;
+                task.run = ReplicaRun(p.users, p.bitrate, p.launched, rc.rng);
+                for (bool antithetic : {false, true})
+                {
+                    if (antithetic && !rc.antithetic)
+                    {
+                        break;
+                    }
+                    task.antithetic = antithetic;
+                    tasks.push_back(task);
+                    owner.push_back(idx);
+                }
+            }
+        }
+        if (tasks.empty())
+        {
+            break;
+        }
+
+        // Las réplicas que ya están en la caché no se simulan
+        std::vector<ReplicaConfig> pending;
+        std::vector<size_t> pendingTask;
+        std::vector<std::pair<size_t, ReplicaResult>> cached;
+        for (size_t t = 0; t < tasks.size(); ++t)
+        {
+            ReplicaResult r;
+            if (rc.cache && rc.cache->Find(tasks[t], r))
+            {
+                cached.emplace_back(t, r);
+            }
+            else
+            {
+                pending.push_back(tasks[t]);
+                pendingTask.push_back(t);
+            }
+        }
+
+        ++round;
+        std::cout << "Ronda " << round << ": " << tasks.size() << " réplicas";
+        if (rc.cache)
+        {
+            std::cout << " (" << cached.size() << " de la caché)";
+        }
+        std::cout << "." << std::endl;
+        size_t done = 0;
+        auto onResult = [&](size_t t, const ReplicaResult& r, bool fromCache) {
+            if (!fromCache || rc.cacheFile != rc.resultsFile)
+            {
+                AppendResult(rc.resultsFile, tasks[t], r);
+            }
+            if (!fromCache && !rc.cacheFile.empty() && rc.cacheFile != rc.resultsFile)
+            {
+                AppendResult(rc.cacheFile, tasks[t], r);
+            }
+            PointState& p = points[owner[t]];
+            if (!fromCache)
+            {
+                ++done;
+                std::cout << "  [" << done << "/" << pending.size() << "] usuarios=" << r.numUsuarios
+                          << " bitrate=" << r.bitrateMbps << "Mbps delay=" << r.delayMs << " ms";
+                if (r.earlyStop || r.precisionStop)
+                {
+                    std::cout << " (" << (r.earlyStop ? "parada anticipada" : "precisión alcanzada") << " en t=" << r.simSeconds << " s)";
+                }
+                if (r.warmupSeconds > 0)
+                {
+                    std::cout << " transitorio=" << r.warmupSeconds << " s";
+                }
+                if (tasks[t].edgeCache.capacity > 0)
+                {
+                    std::cout << " aciertos=" << r.edgeHitRatio * 100 << " %";
+                }
+                std::cout << std::endl;
+            }
+            ReplicaResult sample = r;
+            if (rc.antithetic)
+            {
+                // La muestra de la pareja es la media de la réplica y su antitética
+                auto half = p.halfPairs.find(tasks[t].run);
+                if (half == p.halfPairs.end())
+                {
+                    p.halfPairs[tasks[t].run] = r;
+                    return;
+                }
+                sample.lossRatio = (r.lossRatio + half->second.lossRatio) / 2;
+                sample.delayMs = (r.delayMs + half->second.delayMs) / 2;
+                sample.jitterMs = (r.jitterMs + half->second.jitterMs) / 2;
+                p.halfPairs.erase(half);
+            }
+            p.loss.push_back(sample.lossRatio);
+            p.delay.push_back(sample.delayMs);
+            p.jitter.push_back(sample.jitterMs);
+        };
+        for (const auto& [t, r] : cached)
+        {
+            onResult(t, r, true);
+        }
+        auto onSimulated = [&](size_t i, const ReplicaResult& r) { onResult(pendingTask[i], r, false); };
+        if (rc.model.snapshot)
+        {
+            RunSnapshotPool(pending, rc.jobs, onSimulated);
+        }
+        else
+        {
+            RunReplicaPool(pending, rc.jobs, onSimulated);
+        }
+
+        // Con --antithetic, una mitad que sigue sin pareja al acabar la ronda es que la otra ha
+        // fallado: se pierde la pareja entera, igual que una réplica fallida sin --antithetic
+        for (PointState& p : points)
+        {
+            for (const auto& [run, half] : p.halfPairs)
+            {
+                std::cerr << "Aviso: la pareja antitética (usuarios=" << p.users << ", bitrate=" << p.bitrate
+                          << "Mbps, ejecución=" << run << ") ha perdido una mitad y se descarta." << std::endl;
+            }
+            p.halfPairs.clear();
+        }
+    }
+}
+
+// --- BÚSQUEDA POR BISECCIÓN DEL BITRATE MÍNIMO ---
+struct SearchConfig
+{
+    double minBitrate;
+    double maxBitrate;
+    double initialStep; // Paso inicial al acotar el intervalo a partir del resultado anterior
+    double resolution;  // Anchura final del intervalo [falla, cumple]
+    ReplicationConfig rc;
+};
+
+// Simula las réplicas de un punto en paralelo y lo evalúa con los umbrales de plot-results.
+// Los puntos ya evaluados se reutilizan a través de la caché.
+PointSummary
+EvaluatePoint(uint32_t users,
+              double bitrate,
+              const SearchConfig& sc,
+              std::map<double, PointSummary>& cache)
+{
+    auto it = cache.find(bitrate);
+    if (it != cache.end())
+    {
+        return it->second;
+    }
+
+    std::vector<PointState> points = {{users, bitrate, 0, {}, {}, {}, {}}};
+    RunPoints(points, sc.rc);
+    if (points[0].delay.empty())
+    {
+        NS_FATAL_ERROR("Ninguna réplica de (" << users << " usuarios, " << bitrate << " Mbps) terminó correctamente.");
+    }
+
+    PointSummary p = Summarize(points[0]);
+    std::cout << "  usuarios=" << users << " bitrate=" << bitrate << "Mbps (" << p.replicas
+              << " réplicas) -> delay=" << p.delayMean << " +- " << p.delayMarginOfError
+              << " ms, jitter=" << p.jitterMean << " ms, pérdidas=" << p.lossMean << " % : "
+              << (p.passes ? "CUMPLE" : "NO CUMPLE") << std::endl;
+    cache[bitrate] = p;
+    return p;
+}
+
+// Devuelve el bitrate mínimo (con la resolución pedida) que cumple la QoS para 'users',
+// o un valor negativo si ni siquiera maxBitrate la cumple. Supone que la QoS es monótona
+// en el bitrate. Si se conoce el resultado para el número de usuarios anterior ('hint'),
+// el intervalo se acota alrededor de él con pasos crecientes antes de biseccionar.
+double
+BisectRequiredBitrate(uint32_t users, double hint, const SearchConfig& sc)
+{
+    std::map<double, PointSummary> cache;
+    auto passes = [&](double b) { return EvaluatePoint(users, b, sc, cache).passes; };
+
+    double lo, hi; // lo no cumple, hi cumple
+    if (hint <= 0)
+    {
+        if (!passes(sc.maxBitrate))
+        {
+            return -1;
+        }
+        if (passes(sc.minBitrate))
+        {
+            return sc.minBitrate;
+        }
+        lo = sc.minBitrate;
+        hi = sc.maxBitrate;
+    }
+    else if (passes(hint))
+    {
+        // Acotar hacia abajo
+        hi = hint;
+        double step = sc.initialStep;
+        while (true)
+        {
+            if (hi <= sc.minBitrate)
+            {
+                return sc.minBitrate;
+            }
+            lo = std::max(sc.minBitrate, hi - step);
+            if (!passes(lo))
+            {
+                break;
+            }
+            hi = lo;
+            step *= 2;
+        }
+    }
+    else
+    {
+        // Acotar hacia arriba
+        lo = hint;
+        double step = sc.initialStep;
+        while (true)
+        {
+            if (lo >= sc.maxBitrate)
+            {
+                return -1;
+            }
+            hi = std::min(sc.maxBitrate, lo + step);
+            if (passes(hi))
+            {
+                break;
+            }
+            lo = hi;
+            step *= 2;
+        }
+    }
+
+    while (hi - lo > sc.resolution + 1e-9)
+    {
+        // Punto medio redondeado a la rejilla de la resolución
+        double mid = lo + std::max(1.0, std::floor((hi - lo) / (2 * sc.resolution))) * sc.resolution;
+        if (passes(mid))
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+// Fichero de resultados de una variante de la comparación (--qdiscs, --edgeCaches, --tcps):
+// results.bin -> results.<variante>.bin, con los caracteres raros de la variante cambiados
+// por '_', para que plot-results no mezcle réplicas de configuraciones distintas.
+std::string
+VariantResultsFile(const std::string& resultsFile, const std::string& variant)
+{
+    std::string tag = variant;
+    for (char& c : tag)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_' && c != '+' && c != '-')
+        {
+            c = '_';
+        }
+    }
+    size_t dot = resultsFile.rfind('.');
+    size_t slash = resultsFile.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+    {
+        return resultsFile + "." + tag;
+    }
+    return resultsFile.substr(0, dot) + "." + tag + resultsFile.substr(dot);
+}
+
+// --- COMPARACIÓN FLOWMONITOR / SONDA LIGERA ---
+// Ejecuta las mismas réplicas (mismas ejecuciones) con ambos modos de métricas y muestra la
+// diferencia relativa de cada columna de results.dat, el tiempo real y la memoria máxima.
+// Cada réplica corre en su propio hijo, así que la memoria máxima medida es la de un solo
+// modo. Para medir el tiempo real sin interferencias entre hijos conviene usar --jobs=1.
+void
+CompareMetricModes(const ReplicaConfig& model, uint32_t replicas, uint32_t jobs)
+{
+    std::vector<ReplicaConfig> tasks;
+    for (uint32_t i = 1; i <= replicas; ++i)
+    {
+        for (const char* mode : {"flowmon", "probe"})
+        {
+            ReplicaConfig task = model;
+            task.run = i;
+            task.metrics = mode;
+            tasks.push_back(task);
+        }
+    }
+    std::vector<ReplicaResult> results(tasks.size());
+    std::vector<bool> ok(tasks.size(), false);
+    RunReplicaPool(tasks, jobs, [&](size_t t, const ReplicaResult& r) {
+        results[t] = r;
+        ok[t] = true;
+    });
+
+    auto relDiff = [](double a, double b) {
+        double scale = std::max(std::abs(a), std::abs(b));
+        return scale > 0 ? std::abs(a - b) / scale * 100 : 0.0;
+    };
+    double sumDelayDiff = 0, sumJitterDiff = 0, sumLossDiff = 0;
+    double wall[2] = {0, 0}, rss[2] = {0, 0};
+    uint32_t n = 0;
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Ejecución | Delay flowmon/probe (ms) | Jitter flowmon/probe (ms) | Pérdidas flowmon/probe (%)" << std::endl;
+    for (size_t t = 0; t + 1 < tasks.size(); t += 2)
+    {
+        if (!ok[t] || !ok[t + 1])
+        {
+            continue;
+        }
+        const ReplicaResult& f = results[t];
+        const ReplicaResult& p = results[t + 1];
+        std::cout << tasks[t].run << " | " << f.delayMs << " / " << p.delayMs << " | " << f.jitterMs << " / "
+                  << p.jitterMs << " | " << f.lossRatio << " / " << p.lossRatio << std::endl;
+        sumDelayDiff += relDiff(f.delayMs, p.delayMs);
+        sumJitterDiff += relDiff(f.jitterMs, p.jitterMs);
+        sumLossDiff += std::abs(f.lossRatio - p.lossRatio);
+        wall[0] += f.wallSeconds;
+        wall[1] += p.wallSeconds;
+        rss[0] += f.peakRssKb;
+        rss[1] += p.peakRssKb;
+        ++n;
+    }
+    if (n == 0)
+    {
+        NS_FATAL_ERROR("Ninguna pareja de réplicas terminó correctamente.");
+    }
+    std::cout << "--- Resumen (" << n << " ejecuciones, " << model.numUsuarios << " usuarios, " << model.bitrateMbps
+              << " Mbps) ---" << std::endl;
+    std::cout << "Diferencia media: delay " << sumDelayDiff / n << " %, jitter " << sumJitterDiff / n
+              << " %, pérdidas " << sumLossDiff / n << " puntos porcentuales" << std::endl;
+    std::cout << "Tiempo real medio: flowmon " << wall[0] / n << " s, probe " << wall[1] / n << " s (ahorro "
+              << (1 - wall[1] / wall[0]) * 100 << " %)" << std::endl;
+    std::cout << "Memoria máxima media: flowmon " << rss[0] / n / 1024 << " MB, probe " << rss[1] / n / 1024
+              << " MB (ahorro " << (1 - rss[1] / rss[0]) * 100 << " %)" << std::endl;
+}
+
+// --- BANCO DE PRUEBAS DE RENDIMIENTO DEL SIMULADOR ---
+// Ejecuta el modelo con una ejecución fija en una escalera de usuarios x bitrates, mide el
+// coste de cada caso y lo escribe en JSON (un caso por línea, para poder compararlo con diff).
+// Cada caso se repite 'repeats' veces y se queda el menor tiempo real, el menos perturbado
+// por el resto de la máquina. Con un fichero de referencia, devuelve false si algún caso es
+// más lento o usa más memoria que la referencia en más de 'tolerance' (relativa).
+struct BenchmarkConfig
+{
+    std::vector<uint32_t> users;
+    std::vector<double> bitrates;
+    uint32_t repeats;
+    uint32_t jobs; // 1 para no medir interferencias entre hijos
+    std::string output;
+    std::string baseline;
+    double tolerance;
+};
+
+struct BenchmarkCase
+{
+    uint32_t users;
+    double bitrateMbps;
+    double wallSeconds;
+    double simSeconds;
+    uint64_t events;
+    long peakRssKb;
+    uint64_t bottleneckPackets;
+};
+
+// Valor numérico de "clave": en una línea del JSON del banco de pruebas (NaN si no está)
+double
+JsonField(const std::string& line, const std::string& key)
+{
+    size_t pos = line.find("\"" + key + "\":");
+    return pos == std::string::npos ? std::nan("") : std::strtod(line.c_str() + pos + key.size() + 3, nullptr);
+}
+
+std::vector<BenchmarkCase>
+ReadBenchmark(const std::string& fileName)
+{
+    std::vector<BenchmarkCase> cases;
+    std::ifstream in(fileName);
+    for (std::string line; std::getline(in, line);)
+    {
+        if (line.find("\"users\":") == std::string::npos)
+        {
+            continue;
+        }
+        cases.push_back({static_cast<uint32_t>(JsonField(line, "users")), JsonField(line, "bitrateMbps"),
+                         JsonField(line, "wallSeconds"), JsonField(line, "simSeconds"),
+                         static_cast<uint64_t>(JsonField(line, "events")), static_cast<long>(JsonField(line, "peakRssKb")),
+                         static_cast<uint64_t>(JsonField(line, "bottleneckPackets"))});
+    }
+    return cases;
+}
+
+bool
+RunBenchmark(const ReplicaConfig& model, const BenchmarkConfig& bc)
+{
+    std::vector<ReplicaConfig> tasks;
+    for (uint32_t users : bc.users)
+    {
+        for (double bitrate : bc.bitrates)
+        {
+            for (uint32_t k = 0; k < bc.repeats; ++k)
+            {
+                ReplicaConfig task = model;
+                task.numUsuarios = users;
+                task.bitrateMbps = bitrate;
+                tasks.push_back(task);
+            }
+        }
+    }
+    std::map<std::pair<uint32_t, double>, BenchmarkCase> best;
+    RunReplicaPool(tasks, bc.jobs, [&](size_t, const ReplicaResult& r) {
+        auto key = std::make_pair(r.numUsuarios, r.bitrateMbps);
+        auto it = best.find(key);
+        if (it == best.end() || r.wallSeconds < it->second.wallSeconds)
+        {
+            best[key] = {r.numUsuarios, r.bitrateMbps, r.wallSeconds, r.simSeconds, r.events, r.peakRssKb, r.bottleneckPackets};
+        }
+    });
+
+    std::ofstream out(bc.output);
+    out << std::setprecision(10);
+    out << "{\n  \"model\": \"" << ModelDescription(model) << "\",\n  \"run\": " << model.run
+        << ",\n  \"repeats\": " << bc.repeats << ",\n  \"unixTime\": " << std::time(nullptr) << ",\n  \"cases\": [\n";
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Usuarios | Bitrate (Mbps) | Tiempo real (s) | Simulado/real | Eventos/s | Memoria (MB) | Paquetes cuello" << std::endl;
+    size_t n = 0;
+    for (const auto& [key, c] : best)
+    {
+        out << "    {\"users\": " << c.users << ", \"bitrateMbps\": " << c.bitrateMbps << ", \"wallSeconds\": " << c.wallSeconds
+            << ", \"simSeconds\": " << c.simSeconds << ", \"simWallRatio\": " << c.simSeconds / c.wallSeconds
+            << ", \"events\": " << c.events << ", \"eventsPerSecond\": " << c.events / c.wallSeconds
+            << ", \"peakRssKb\": " << c.peakRssKb << ", \"bottleneckPackets\": " << c.bottleneckPackets << "}"
+            << (++n < best.size() ? "," : "") << "\n";
+        std::cout << c.users << " | " << c.bitrateMbps << " | " << c.wallSeconds << " | " << c.simSeconds / c.wallSeconds << " | "
+                  << c.events / c.wallSeconds << " | " << c.peakRssKb / 1024.0 << " | " << c.bottleneckPackets << std::endl;
+    }
+    out << "  ]\n}\n";
+    std::cout << "Resultados del banco de pruebas en " << bc.output << std::endl;
+    if (best.size() * bc.repeats < tasks.size())
+    {
+        std::cerr << "Aviso: algunas ejecuciones del banco de pruebas terminaron con error." << std::endl;
+    }
+
+    if (bc.baseline.empty())
+    {
+        return true;
+    }
+    std::vector<BenchmarkCase> reference = ReadBenchmark(bc.baseline);
+    NS_ABORT_MSG_IF(reference.empty(), "No se pudo leer la referencia del banco de pruebas " << bc.baseline);
+    bool ok = true;
+    for (const BenchmarkCase& ref : reference)
+    {
+        std::ostringstream label;
+        label << ref.users << " usuarios, " << ref.bitrateMbps << " Mbps";
+        auto it = best.find(std::make_pair(ref.users, ref.bitrateMbps));
+        if (it == best.end())
+        {
+            // Un caso de la referencia que no se ha medido (falló o ya no está en el banco)
+            std::cout << "FALTA (" << label.str() << "): el caso de la referencia no tiene medida" << std::endl;
+            ok = false;
+            continue;
+        }
+        const BenchmarkCase& c = it->second;
+        if (c.events != ref.events || c.bottleneckPackets != ref.bottleneckPackets)
+        {
+            // Otro número de eventos o paquetes indica un cambio del modelo, no solo de velocidad
+            std::cout << "Aviso (" << label.str() << "): el modelo ha cambiado (eventos " << ref.events << " -> " << c.events
+                      << ", paquetes " << ref.bottleneckPackets << " -> " << c.bottleneckPackets << ")" << std::endl;
+        }
+        if (c.wallSeconds > ref.wallSeconds * (1 + bc.tolerance))
+        {
+            std::cout << "REGRESIÓN (" << label.str() << "): tiempo real " << ref.wallSeconds << " -> " << c.wallSeconds << " s" << std::endl;
+            ok = false;
+        }
+        if (c.peakRssKb > ref.peakRssKb * (1 + bc.tolerance))
+        {
+            std::cout << "REGRESIÓN (" << label.str() << "): memoria " << ref.peakRssKb / 1024.0 << " -> " << c.peakRssKb / 1024.0 << " MB" << std::endl;
+            ok = false;
+        }
+    }
+    std::cout << (ok ? "Sin regresiones" : "Hay regresiones") << " frente a " << bc.baseline << " (tolerancia "
+              << bc.tolerance * 100 << " %)." << std::endl;
+    return ok;
+}
+
+int
+main(int argc, char* argv[])
+{
+    // La resolución se fija antes de crear ningún Time (la descripción de la topología los usa)
+    Time::SetResolution(Time::US);
+
+    // --- PARÁMETROS DE SIMULACIÓN ---
+    bool enableLogs = false; // <--  Flag para controlar los logs
+    uint32_t num_usuarios = 100;
+    std::string bitrate_str = "8Mbps";
+    uint32_t semilla = 1;
+    uint32_t run = 1;
+    std::string rng = "crn";
+    bool antithetic = false;
+    std::string serverApp = "onoff";
+    std::string metrics = "flowmon";
+    bool compareMetrics = false;
+    bool benchmark = false;
+    std::string benchUsers = "100,300,500";
+    std::string benchBitrates = "20,60,120";
+    uint32_t benchRepeats = 3;
+    std::string benchOutput = "benchmark.json";
+    std::string benchBaseline = "";
+    double benchTolerance = 0.10;
+    std::string queueTrace = "";
+    double queueTraceInterval = 0.01;
+    bool earlyStop = false;
+    bool warmup = false;
+    double runPrecision = 0.0;
+    double analysisWindow = 1.0;
+    uint32_t analysisMinWindows = 6;
+    std::string intervalTrace = "";
+    std::string routing = "global";
+    std::string topologyFile = "";
+    std::string writeTopology = "";
+    std::string access = "";
+    bool mpi = false;
+    std::string qdisc = "";
+    std::string deviceQueue = "5p";
+    std::string qdiscs = "";
+    uint32_t edgeCache = 0;
+    uint32_t edgeCatalogue = 10000;
+    double edgeZipf = 0.8;
+    std::string edgePolicy = "lru";
+    std::string edgeCaches = "";
+    std::string tcp = "";
+    bool pacing = false;
+    uint32_t initialCwnd = 0;
+    uint32_t tcpSndBuf = 0;
+    uint32_t tcpRcvBuf = 0;
+    std::string tcps = "";
+    std::string dashLadder = "";
+    double dashSegment = 2.0;
+    std::string dashAbr = "buffer";
+    std::string profile = "";
+    uint32_t profileTop = 20;
+
+    // --- PARÁMETROS DEL BARRIDO (--sweep) ---
+    bool sweep = false;
+    uint32_t minUsers = 100, maxUsers = 500, stepUsers = 50;
+    double minBitrate = 10, maxBitrate = 120, stepBitrate = 10;
+    uint32_t replicas = 10;
+    bool sequential = false;
+    uint32_t minReplicas = 3, maxReplicas = 50;
+    double ciRelative = 0.05, ciAbsolute = 0.0;
+    uint32_t jobs = 0;
+    std::string resultsFile = "results.bin";
+    std::string cacheFile = "";
+    bool snapshot = false;
+    std::string search = "grid";
+    double resolution = 1.0;
+    std::string requiredFile = "required_bitrate.dat";
+
+    CommandLine cmd;
+    cmd.AddValue("enableLogs", "Habilitar logs detallados", enableLogs); // <-- argumento para activar logs
+    cmd.AddValue("num_usuarios", "Numero de usuarios a simular", num_usuarios);
+    cmd.AddValue("bitrate", "Bitrate del enlace L1", bitrate_str);
+    cmd.AddValue("semilla", "Semilla base del generador aleatorio (común a todas las réplicas)", semilla);
+    cmd.AddValue("run", "Ejecución del generador (RngSeedManager::SetRun) de la réplica individual", run);
+    cmd.AddValue("rng", "Barrido: 'crn' (la réplica i usa la ejecución i en todos los bitrates) o 'independent' (ejecuciones distintas por punto)", rng);
+    cmd.AddValue("antithetic", "Réplicas individuales: fuentes antitéticas; barrido: réplicas por parejas antitéticas", antithetic);
+    cmd.AddValue("serverApp", "Fuentes de tráfico: 'onoff' (una aplicación por usuario), 'aggregated' (una por clase) o 'dash' (segmentos con adaptación de calidad)", serverApp);
+    cmd.AddValue("dashLadder", "DASH: escalera de bitrates separados por comas (vacío = las tasas de las clases)", dashLadder);
+    cmd.AddValue("dashSegment", "DASH: duración de los segmentos (s)", dashSegment);
+    cmd.AddValue("dashAbr", "DASH: algoritmo de adaptación, 'buffer' (BBA-0) o 'throughput' (media armónica del caudal)", dashAbr);
+    cmd.AddValue("metrics", "Recogida de métricas: 'flowmon' (FlowMonitor en todos los nodos) o 'probe' (sonda ligera en los extremos)", metrics);
+    cmd.AddValue("compareMetrics", "Comparar flowmon y probe (métricas, tiempo y memoria) con las mismas ejecuciones", compareMetrics);
+    cmd.AddValue("benchmark", "Banco de pruebas de rendimiento: tiempo real, eventos, memoria y paquetes por caso, en JSON", benchmark);
+    cmd.AddValue("benchUsers", "Banco de pruebas: usuarios de los casos, separados por comas", benchUsers);
+    cmd.AddValue("benchBitrates", "Banco de pruebas: bitrates (Mbps) de los casos, separados por comas", benchBitrates);
+    cmd.AddValue("benchRepeats", "Banco de pruebas: repeticiones de cada caso (se queda el menor tiempo)", benchRepeats);
+    cmd.AddValue("benchOutput", "Banco de pruebas: fichero JSON de resultados", benchOutput);
+    cmd.AddValue("benchBaseline", "Banco de pruebas: JSON de referencia; termina con error si hay regresiones", benchBaseline);
+    cmd.AddValue("benchTolerance", "Banco de pruebas: empeoramiento relativo tolerado frente a la referencia", benchTolerance);
+    cmd.AddValue("profile", "Perfil de eventos por manejador y nodo: prefijo de los ficheros .folded (flame graph) y .queue (vacío = desactivado)", profile);
+    cmd.AddValue("profileTop", "Perfil de eventos: filas de la tabla de manejadores más costosos", profileTop);
+    cmd.AddValue("queueTrace", "Prefijo del fichero binario con la serie temporal de la cola router1->router2 (vacío = desactivada)", queueTrace);
+    cmd.AddValue("queueTraceInterval", "Intervalo de muestreo de la cola (s)", queueTraceInterval);
+    cmd.AddValue("earlyStop", "Detener la réplica en cuanto el IC del retardo, el jitter y las pérdidas decide si cumple la QoS", earlyStop);
+    cmd.AddValue("warmup", "Detectar el transitorio inicial con MSER y descartarlo de las métricas", warmup);
+    cmd.AddValue("runPrecision", "Detener la réplica cuando el semiancho del IC por lotes sea esta fracción de la media (0 = duración fija)", runPrecision);
+    cmd.AddValue("analysisWindow", "Análisis de salida (--earlyStop, --warmup, --runPrecision): duración de cada intervalo de medida (s)", analysisWindow);
+    cmd.AddValue("analysisMinWindows", "Análisis de salida: intervalos mínimos tras el transitorio antes de detener la réplica", analysisMinWindows);
+    cmd.AddValue("intervalTrace", "Prefijo del fichero de texto con retardo, jitter y pérdidas por intervalo (vacío = desactivado)", intervalTrace);
+    cmd.AddValue("routing", "Encaminamiento: 'rip' (convergencia en los 10 primeros segundos), 'global' o 'static' (tablas precalculadas, tráfico desde t=0)", routing);
+    cmd.AddValue("topology", "Fichero de descripción de la topología (vacío = escenario Valencia/Baleares)", topologyFile);
+    cmd.AddValue("access", "Red de acceso de todas las regiones: 'csma' o 'aggregated:<S>' (S usuarios por nodo); vacío = la de la topología", access);
+    cmd.AddValue("mpi", "Reparte una réplica entre los procesos MPI (una región por proceso; lanzar con mpiexec)", mpi);
+    cmd.AddValue("qdisc", "Disciplina de cola en router1 hacia el cuello de botella: fq_codel, codel, pie, red, pfifo, none o default (la de ns-3 con --deviceQueue), con atributos opcionales, p. ej. 'codel[Target=5ms|Interval=100ms]' (vacío = la de ns-3 sin cambios)", qdisc);
+    cmd.AddValue("deviceQueue", "Con --qdisc: tamaño de la cola propia del dispositivo del cuello de botella", deviceQueue);
+    cmd.AddValue("qdiscs", "Bisección: lista separada por comas de disciplinas (--qdisc) cuyo bitrate mínimo se compara con la primera", qdiscs);
+    cmd.AddValue("edgeCache", "Capacidad (títulos) de la caché de borde de cada router de región; los aciertos no cruzan el enlace router1 -> región (0 = sin caché)", edgeCache);
+    cmd.AddValue("edgeCatalogue", "Cachés de borde: títulos del catálogo", edgeCatalogue);
+    cmd.AddValue("edgeZipf", "Cachés de borde: exponente de la popularidad Zipf de los títulos", edgeZipf);
+    cmd.AddValue("edgePolicy", "Cachés de borde: reemplazo 'lru' o 'lfu'", edgePolicy);
+    cmd.AddValue("edgeCaches", "Bisección: lista separada por comas de capacidades de caché de borde (0 = sin caché) cuyo bitrate mínimo se compara con la primera", edgeCaches);
+    cmd.AddValue("tcp", "Control de congestión de TCP: 'newreno', 'cubic', 'bbr' o 'dctcp' (o un TypeId de ns-3; vacío = el de ns-3 por defecto)", tcp);
+    cmd.AddValue("pacing", "TCP: espaciar los envíos a la tasa de pacing (BBR lo activa siempre)", pacing);
+    cmd.AddValue("initialCwnd", "TCP: ventana inicial en segmentos (0 = la de ns-3)", initialCwnd);
+    cmd.AddValue("tcpSndBuf", "TCP: buffer de envío de cada socket en bytes (0 = el de ns-3)", tcpSndBuf);
+    cmd.AddValue("tcpRcvBuf", "TCP: buffer de recepción de cada socket en bytes (0 = el de ns-3)", tcpRcvBuf);
+    cmd.AddValue("tcps", "Bisección: lista separada por comas de variantes de TCP, con '+pacing' opcional (p. ej. 'default,newreno,bbr,cubic+pacing'), cuyo bitrate mínimo se compara con la primera", tcps);
+    cmd.AddValue("writeTopology", "Escribe la topología en uso en este fichero, como plantilla, y termina", writeTopology);
+    cmd.AddValue("sweep", "Ejecutar el barrido completo (usuarios x bitrate x réplicas) en paralelo", sweep);
+    cmd.AddValue("minUsers", "Barrido: número mínimo de usuarios", minUsers);
+    cmd.AddValue("maxUsers", "Barrido: número máximo de usuarios", maxUsers);
+    cmd.AddValue("stepUsers", "Barrido: paso de usuarios", stepUsers);
+    cmd.AddValue("minBitrate", "Barrido: bitrate mínimo (Mbps)", minBitrate);
+    cmd.AddValue("maxBitrate", "Barrido: bitrate máximo (Mbps)", maxBitrate);
+    cmd.AddValue("stepBitrate", "Barrido: paso de bitrate (Mbps)", stepBitrate);
+    cmd.AddValue("replicas", "Barrido: réplicas por punto", replicas);
+    cmd.AddValue("sequential", "Barrido: añadir réplicas hasta alcanzar la precisión del IC del 95%", sequential);
+    cmd.AddValue("minReplicas", "Replicación secuencial: réplicas iniciales por punto", minReplicas);
+    cmd.AddValue("maxReplicas", "Replicación secuencial: máximo de réplicas por punto", maxReplicas);
+    cmd.AddValue("ciRelative", "Replicación secuencial: semiancho objetivo relativo a la media (o al umbral de QoS si la media es menor)", ciRelative);
+    cmd.AddValue("ciAbsolute", "Replicación secuencial: semiancho objetivo absoluto (ms o %)", ciAbsolute);
+    cmd.AddValue("jobs", "Barrido: procesos en paralelo (0 = todos los núcleos)", jobs);
+    cmd.AddValue("resultsFile", "Fichero donde se añaden los resultados (binario; texto si acaba en .dat)", resultsFile);
+    cmd.AddValue("cacheFile", "Barrido: almacén binario de réplicas ya simuladas, que se reutilizan en lugar de repetirlas (vacío = sin caché)", cacheFile);
+    cmd.AddValue("snapshot", "Barrido: construir (y converger) el escenario una vez por número de usuarios y continuar cada réplica en un hijo con fork()", snapshot);
+    cmd.AddValue("search", "Barrido: 'grid' (rejilla completa) o 'bisect' (bisección del bitrate mínimo)", search);
+    cmd.AddValue("resolution", "Bisección: resolución del bitrate mínimo (Mbps)", resolution);
+    cmd.AddValue("requiredFile", "Bisección: fichero con la curva de bitrate requerido", requiredFile);
+    cmd.Parse(argc, argv);
+
+    if (enableLogs)
+    {
+        LogComponentEnable("OnOffRoutingExperiment", LOG_LEVEL_ALL);
+        NS_LOG_FUNCTION(argc << argv);
+    }
+
+    if (serverApp != "onoff" && serverApp != "aggregated" && serverApp != "dash")
+    {
+        NS_FATAL_ERROR("Aplicación de servidor desconocida: " << serverApp);
+    }
+    if (metrics != "flowmon" && metrics != "probe")
+    {
+        NS_FATAL_ERROR("Modo de métricas desconocido: " << metrics);
+    }
+    if (routing != "rip" && routing != "global" && routing != "static")
+    {
+        NS_FATAL_ERROR("Modo de encaminamiento desconocido: " << routing);
+    }
+    if (dashAbr != "buffer" && dashAbr != "throughput")
+    {
+        NS_FATAL_ERROR("Algoritmo de adaptación DASH desconocido: " << dashAbr);
+    }
+    if (rng != "crn" && rng != "independent")
+    {
+        NS_FATAL_ERROR("Modo de números aleatorios desconocido: " << rng);
+    }
+    std::vector<std::string> qdiscList;
+    std::istringstream qdiscsIn(qdiscs);
+    for (std::string item; std::getline(qdiscsIn, item, ',');)
+    {
+        ParseQdiscSpec(item); // Valida la especificación antes de lanzar nada
+        qdiscList.push_back(item);
+    }
+    NS_ABORT_MSG_IF(!qdiscList.empty() && (!sweep || search != "bisect"), "--qdiscs compara el bitrate mínimo: necesita --sweep=true --search=bisect");
+    if (edgePolicy != "lru" && edgePolicy != "lfu")
+    {
+        NS_FATAL_ERROR("Política de reemplazo de la caché de borde desconocida: " << edgePolicy);
+    }
+    NS_ABORT_MSG_IF(edgeCatalogue == 0, "--edgeCatalogue debe ser positivo");
+    std::vector<std::string> edgeCacheList;
+    std::istringstream edgeCachesIn(edgeCaches);
+    for (std::string item; std::getline(edgeCachesIn, item, ',');)
+    {
+        NS_ABORT_MSG_IF(item.empty() || item.find_first_not_of("0123456789") != std::string::npos,
+                        "--edgeCaches: capacidad no válida '" << item << "'");
+        edgeCacheList.push_back(item);
+    }
+    NS_ABORT_MSG_IF(!edgeCacheList.empty() && (!sweep || search != "bisect"), "--edgeCaches compara el bitrate mínimo: necesita --sweep=true --search=bisect");
+    TcpVariantTypeId(tcp); // Valida el nombre antes de lanzar nada
+    TcpConfig tcpConfig{tcp == "default" ? "" : tcp, pacing, initialCwnd, tcpSndBuf, tcpRcvBuf};
+    std::vector<std::string> tcpList;
+    std::istringstream tcpsIn(tcps);
+    for (std::string item; std::getline(tcpsIn, item, ',');)
+    {
+        ParseTcpVariant(item, tcpConfig);
+        tcpList.push_back(item);
+    }
+    NS_ABORT_MSG_IF(!tcpList.empty() && (!sweep || search != "bisect"), "--tcps compara el bitrate mínimo: necesita --sweep=true --search=bisect");
+    NS_ABORT_MSG_IF(!qdiscList.empty() + !edgeCacheList.empty() + !tcpList.empty() > 1,
+                    "--qdiscs, --edgeCaches y --tcps no se combinan: compara una cosa cada vez");
+    NS_ABORT_MSG_IF(snapshot && !sweep, "--snapshot reparte las réplicas de un barrido: necesita --sweep=true");
+    NS_ABORT_MSG_IF(analysisWindow <= 0, "--analysisWindow debe ser positivo");
+    NS_ABORT_MSG_IF(sweep && stepUsers == 0, "--stepUsers debe ser positivo");
+    NS_ABORT_MSG_IF(sweep && stepBitrate <= 0, "--stepBitrate debe ser positivo");
+    NS_ABORT_MSG_IF(sweep && minUsers > maxUsers, "--minUsers no puede ser mayor que --maxUsers");
+    // La bisección divide por --resolution y acota el intervalo con pasos que empiezan en --stepBitrate
+    NS_ABORT_MSG_IF(sweep && search == "bisect" && resolution <= 0, "--resolution debe ser positiva");
+    NS_ABORT_MSG_IF(sweep && minBitrate <= 0, "--minBitrate debe ser positivo");
+    NS_ABORT_MSG_IF(sweep && minBitrate > maxBitrate, "--minBitrate no puede ser mayor que --maxBitrate");
+    if (!qdisc.empty())
+    {
+        ParseQdiscSpec(qdisc);
+    }
+    TopologySpec topology = topologyFile.empty() ? DefaultTopologySpec() : LoadTopologySpec(topologyFile);
+    if (!access.empty())
+    {
+        std::replace(access.begin(), access.end(), ':', ' ');
+        uint32_t sessionsPerNode = ParseAccessSpec(access, "--access");
+        for (auto& region : topology.regions)
+        {
+            region.sessionsPerNode = sessionsPerNode;
+        }
+    }
+    if (!writeTopology.empty())
+    {
+        std::ofstream out(writeTopology);
+        out << topology;
+        std::cout << "Topología escrita en " << writeTopology << std::endl;
+        return 0;
+    }
+    // DataRate entiende todas las unidades de ns-3 (kbps, Mbps, Gbps...); el modelo trabaja en Mbps
+    double bitrate_val = DataRate(bitrate_str).GetBitRate() / 1e6;
+    ReplicaConfig model{num_usuarios, bitrate_val, semilla, run, antithetic, enableLogs, serverApp, metrics, queueTrace, queueTraceInterval, routing, topology, 1, qdisc, deviceQueue, dashLadder, dashSegment, dashAbr, profile, profileTop, snapshot, earlyStop, warmup, runPrecision, analysisWindow, analysisMinWindows, intervalTrace, EdgeCacheConfig{edgeCache, edgeCatalogue, edgeZipf, edgePolicy}, tcpConfig};
+
+    // --- SIMULACIÓN DISTRIBUIDA (MPI) ---
+    // Todos los procesos construyen la misma topología y cada uno simula el servidor y router1
+    // (proceso 0) o sus regiones. Solo el proceso 0 escribe la fila de resultados.
+    if (mpi)
+    {
+#ifdef NS3_MPI
+        NS_ABORT_MSG_IF(sweep || compareMetrics || benchmark, "--mpi reparte una única réplica: no se combina con --sweep, --compareMetrics ni --benchmark");
+        NS_ABORT_MSG_IF(!profile.empty(), "--profile no está disponible con --mpi (necesita su propia implementación del Simulator)");
+        NS_ABORT_MSG_IF(serverApp == "dash", "--serverApp=dash no está disponible con --mpi (las métricas de los clientes quedan en cada proceso)");
+        NS_ABORT_MSG_IF(metrics != "probe", "--mpi necesita --metrics=probe (FlowMonitor no suma los flujos de varios procesos)");
+        NS_ABORT_MSG_IF(!queueTrace.empty(), "--queueTrace no está disponible con --mpi (el enlace cuello de botella es punto a punto)");
+        NS_ABORT_MSG_IF(earlyStop || warmup || runPrecision > 0 || !intervalTrace.empty(),
+                        "El análisis de salida (--earlyStop, --warmup, --runPrecision, --intervalTrace) no está disponible con --mpi (cada proceso solo ve los contadores de sus nodos)");
+        NS_ABORT_MSG_IF(edgeCache > 0, "--edgeCache no está disponible con --mpi (las fuentes de las cachés irían en los procesos de las regiones)");
+        GlobalValue::Bind("SimulatorImplementationType", StringValue("ns3::DistributedSimulatorImpl"));
+        MpiInterface::Enable(&argc, &argv);
+        model.mpiRanks = MpiInterface::GetSize();
+        ReplicaResult r = RunReplica(model);
+        if (MpiInterface::GetSystemId() == 0)
+        {
+            AppendResult(resultsFile, model, r);
+        }
+        MpiInterface::Disable();
+        return 0;
+#else
+        NS_FATAL_ERROR("Este ns-3 se ha compilado sin MPI: configúralo con ./ns3 configure --enable-mpi");
+#endif
+    }
+
+    if (benchmark)
+    {
+        BenchmarkConfig bc{{}, {}, std::max(1u, benchRepeats), jobs == 0 ? 1 : jobs, benchOutput, benchBaseline, benchTolerance};
+        std::istringstream usersIn(benchUsers), bitratesIn(benchBitrates);
+        for (std::string item; std::getline(usersIn, item, ',');)
+        {
+            bc.users.push_back(std::stoul(item));
+        }
+        for (std::string item; std::getline(bitratesIn, item, ',');)
+        {
+            bc.bitrates.push_back(std::stod(item));
+        }
+        return RunBenchmark(model, bc) ? 0 : 1;
+    }
+
+    if (compareMetrics)
+    {
+        CompareMetricModes(model, replicas, jobs);
+        return 0;
+    }
+
+    if (!sweep)
+    {
+        ReplicaResult r = RunReplica(model);
+        AppendResult(resultsFile, model, r);
+        return 0;
+    }
+
+    // En el barrido las réplicas eligen su ejecución y, por parejas, si son antitéticas
+    ReplicationConfig rc{replicas, replicas, 0.0, 0.0, jobs, resultsFile, rng, antithetic, model};
+    rc.model.antithetic = false;
+    if (sequential)
+    {
+        rc.minReplicas = std::max(2u, minReplicas);
+        rc.maxReplicas = std::max(rc.minReplicas, maxReplicas);
+        rc.ciRelative = ciRelative;
+        rc.ciAbsolute = ciAbsolute;
+    }
+    if (snapshot)
+    {
+        NS_ABORT_MSG_IF(!queueTrace.empty(), "--snapshot no admite --queueTrace (el muestreo de la cola se programa con el bitrate de la instantánea)");
+        NS_ABORT_MSG_IF(routing == "rip" && !qdisc.empty() && ParseQdiscSpec(qdisc).typeId == "ns3::RedQueueDisc",
+                        "--snapshot con RIP no admite --qdisc=red (RED fija sus parámetros con el bitrate de la instantánea)");
+        NS_ABORT_MSG_IF(edgeCache > 0 || !edgeCacheList.empty(),
+                        "--snapshot no admite cachés de borde (los aciertos se deciden al construir el escenario, con la ejecución de la instantánea)");
+    }
+    if (!cacheFile.empty())
+    {
+        NS_ABORT_MSG_IF(cacheFile.size() >= 4 && cacheFile.compare(cacheFile.size() - 4, 4, ".dat") == 0,
+                        "--cacheFile necesita el almacén binario, no un fichero de texto .dat");
+        MappedResults existing(cacheFile);
+        NS_ABORT_MSG_IF(existing.IsValid() && existing.RecordSize() != sizeof(ResultRecord),
+                        "--cacheFile: " << cacheFile << " es de una versión anterior del esquema de resultados; bórralo (run.sh --fresh)");
+        rc.cacheFile = cacheFile;
+        rc.cache = std::make_shared<ReplicaCache>(cacheFile);
+        std::cout << "Caché de réplicas " << cacheFile << ": " << rc.cache->Size() << " réplicas." << std::endl;
+    }
+
+    if (search == "bisect")
+    {
+        // --- BÚSQUEDA DEL BITRATE MÍNIMO POR BISECCIÓN ---
+        SearchConfig sc{minBitrate, maxBitrate, stepBitrate, resolution, rc};
+        std::ofstream reqFile(requiredFile);
+        // Variantes comparadas: disciplinas de cola (--qdiscs), capacidades de caché de borde
+        // (--edgeCaches) o variantes de TCP (--tcps)
+        bool comparingCaches = !edgeCacheList.empty();
+        bool comparingTcp = !tcpList.empty();
+        std::vector<std::string> variants = comparingCaches ? edgeCacheList : comparingTcp ? tcpList : qdiscList;
+        std::string variantOption = comparingCaches ? "--edgeCache=" : comparingTcp ? "TCP " : "--qdisc=";
+        bool comparing = !variants.empty();
+        if (!comparing)
+        {
+            reqFile << "# Usuarios BitrateRequerido(Mbps)" << std::endl;
+            variants.push_back(qdisc);
+        }
+        else
+        {
+            // Una columna por variante (-1 = ninguna hasta maxBitrate)
+            reqFile << "# Usuarios";
+            for (const auto& v : variants)
+            {
+                reqFile << " " << (comparingCaches ? "cache" : "") << v;
+            }
+            reqFile << std::endl;
+        }
+        std::vector<double> previous(variants.size(), -1);
+        for (uint32_t users = minUsers; users <= maxUsers; users += stepUsers)
+        {
+            std::vector<double> required(variants.size());
+            for (size_t q = 0; q < variants.size(); ++q)
+            {
+                if (comparingCaches)
+                {
+                    sc.rc.model.edgeCache.capacity = std::stoul(variants[q]);
+                }
+                else if (comparingTcp)
+                {
+                    sc.rc.model.tcp = ParseTcpVariant(variants[q], tcpConfig);
+                }
+                else
+                {
+                    // También 'default' reduce la cola del dispositivo a --deviceQueue
+                    sc.rc.model.qdisc = variants[q];
+                }
+                if (comparing)
+                {
+                    sc.rc.resultsFile = VariantResultsFile(resultsFile, (comparingCaches ? "cache" : "") + variants[q]);
+                }
+                std::cout << "Bisección para " << users << " usuarios"
+                          << (comparing ? " con " + variantOption + variants[q] : "") << "..." << std::endl;
+                required[q] = BisectRequiredBitrate(users, previous[q], sc);
+                if (required[q] > 0)
+                {
+                    std::cout << "Para " << users << " usuarios, Bitrate Min: " << required[q] << " Mbps" << std::endl;
+                    previous[q] = required[q];
+                }
+                else
+                {
+                    std::cout << "Aviso: Para " << users << " usuarios, ningún bitrate hasta " << maxBitrate
+                              << " Mbps cumplió los requisitos de QoS." << std::endl;
+                }
+            }
+            if (!comparing)
+            {
+                if (required[0] > 0)
+                {
+                    reqFile << users << " " << required[0] << std::endl;
+                }
+                continue;
+            }
+            reqFile << users;
+            for (double r : required)
+            {
+                reqFile << " " << (r > 0 ? r : -1);
+            }
+            reqFile << std::endl;
+            // Capacidad que ahorra cada variante frente a la primera de la lista
+            for (size_t q = 1; q < variants.size() && required[0] > 0; ++q)
+            {
+                if (required[q] > 0)
+                {
+                    std::cout << "  " << variantOption << variants[q] << " frente a " << variantOption << variants[0] << ": "
+                              << required[0] - required[q] << " Mbps menos ("
+                              << (required[0] - required[q]) / required[0] * 100 << " %)" << std::endl;
+                }
+            }
+        }
+        return 0;
+    }
+    if (search != "grid")
+    {
+        NS_FATAL_ERROR("Modo de búsqueda desconocido: " << search);
+    }
+
+    // --- BARRIDO COMPLETO ---
+    std::vector<PointState> points;
+    for (uint32_t users = minUsers; users <= maxUsers; users += stepUsers)
+    {
+        for (double bitrate = minBitrate; bitrate <= maxBitrate + 1e-9; bitrate += stepBitrate)
+        {
+            points.push_back({users, bitrate, 0, {}, {}, {}, {}});
+        }
+    }
+
+    std::cout << "Barrido: " << points.size() << " puntos en "
+              << (jobs ? jobs : std::max(1u, std::thread::hardware_concurrency())) << " procesos." << std::endl;
+    RunPoints(points, rc);
+
+    uint32_t total = 0;
+    for (const auto& p : points)
+    {
+        total += p.delay.size();
+    }
+    std::cout << "Barrido completado: " << total << " réplicas para " << points.size() << " puntos." << std::endl;
+
     return 0;
 }
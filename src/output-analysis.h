@@ -0,0 +1,319 @@
+#ifndef OUTPUT_ANALYSIS_H
+#define OUTPUT_ANALYSIS_H
+
+#include "qos-stats.h"
+#include "user-qos.h"
+
+#include "ns3/nstime.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+
+// Métricas de un intervalo, calculadas a partir de los contadores de sus extremos
+struct IntervalMetrics
+{
+    double endSeconds = 0; // Instante simulado en que termina el intervalo
+    double delayMs = 0;
+    double jitterMs = 0;
+    double lossPercent = 0;
+};
+
+/**
+ * Métricas entre dos lecturas de los contadores, con las mismas definiciones que las métricas
+ * finales: medias por flujo de retardo y jitter y pérdidas como (enviados - recibidos) /
+ * enviados, solo con los flujos de más de 10 paquetes. 'before' vacío equivale a ceros.
+ *
+ * Los paquetes en vuelo al principio y al final del intervalo se compensan en media, así que
+ * las pérdidas pueden ser ligeramente negativas en un intervalo corto sin pérdidas.
+ */
+inline IntervalMetrics
+CountersDifference(const std::vector<FlowCounters>& before, const std::vector<FlowCounters>& now)
+{
+    static const FlowCounters zero;
+    double delaySum = 0, jitterSum = 0, tx = 0, lost = 0;
+    uint32_t delayCount = 0, jitterCount = 0;
+    for (size_t f = 0; f < now.size(); ++f)
+    {
+        const FlowCounters& b = f < before.size() ? before[f] : zero;
+        if (now[f].txPackets <= 10)
+        {
+            continue;
+        }
+        double sent = now[f].txPackets - b.txPackets;
+        double rx = now[f].rxPackets - b.rxPackets;
+        tx += sent;
+        lost += sent - rx;
+        if (rx > 0)
+        {
+            delaySum += (now[f].delaySumS - b.delaySumS) / rx * 1000;
+            ++delayCount;
+        }
+        if (rx > 1)
+        {
+            jitterSum += (now[f].jitterSumS - b.jitterSumS) / (rx - 1) * 1000;
+            ++jitterCount;
+        }
+    }
+    IntervalMetrics m;
+    m.endSeconds = Simulator::Now().GetSeconds();
+    m.delayMs = delayCount > 0 ? delaySum / delayCount : 0;
+    m.jitterMs = jitterCount > 0 ? jitterSum / jitterCount : 0;
+    m.lossPercent = tx > 0 ? lost / tx * 100 : 0;
+    return m;
+}
+
+// Regla MSER (marginal standard error rule): número de observaciones iniciales que se
+// descartan, el d que minimiza sum_{i>=d} (y_i - media_d)^2 / (n - d)^2. Solo se buscan
+// truncamientos de hasta la mitad de la serie, como recomienda White (1997).
+inline size_t
+MserTruncation(const std::vector<double>& y)
+{
+    size_t n = y.size();
+    if (n < 4)
+    {
+        return 0;
+    }
+    // Sumas acumuladas desde el final para evaluar cada d en O(1)
+    std::vector<double> sum(n + 1, 0.0), sumSq(n + 1, 0.0);
+    for (size_t i = n; i-- > 0;)
+    {
+        sum[i] = sum[i + 1] + y[i];
+        sumSq[i] = sumSq[i + 1] + y[i] * y[i];
+    }
+    size_t best = 0;
+    double bestValue = INFINITY;
+    for (size_t d = 0; d <= n / 2; ++d)
+    {
+        double m = n - d;
+        double value = std::max(0.0, sumSq[d] - sum[d] * sum[d] / m) / (m * m);
+        if (value < bestValue)
+        {
+            bestValue = value;
+            best = d;
+        }
+    }
+    return best;
+}
+
+// --- ANÁLISIS DE SALIDA DURANTE LA SIMULACIÓN ---
+struct OutputAnalysisConfig
+{
+    Time window;         // Duración de cada intervalo de medida
+    uint32_t minWindows; // Intervalos mínimos tras el transitorio antes de decidir
+    bool earlyStop;      // Detener la réplica cuando su resultado de QoS está decidido (--earlyStop)
+    bool warmup;         // Detectar el transitorio con MSER y descartarlo de las métricas (--warmup)
+    double precision;    // Detener la réplica cuando el IC alcanza esta precisión relativa (0 = no)
+};
+
+/**
+ * Analizador de la salida de una réplica (--earlyStop, --warmup, --runPrecision).
+ *
+ * Cada 'window' de tiempo simulado lee los contadores acumulados de los flujos y guarda las
+ * métricas de ese intervalo. Los intervalos se tratan como medias por lotes: tras descartar
+ * el transitorio, con al menos 'minWindows' intervalos, la media de cada métrica lleva un IC
+ * de la t de Student con el cuantil 0.975.
+ *
+ * - Transitorio: con 'warmup' se elige con MSER sobre las series de retardo, jitter y pérdidas
+ *   (el mayor de los tres truncamientos) y las métricas finales se calculan solo con los
+ *   contadores posteriores (Metrics()); Transient() da los contadores de cada flujo y los
+ *   histogramas de los usuarios al final del transitorio para hacer lo mismo con la
+ *   distribución por usuario. Sin él se descarta el primer intervalo, que recoge el
+ *   arranque lento de las conexiones TCP, solo para las decisiones de parada.
+ * - Parada anticipada: la réplica falla si el extremo inferior de alguna métrica supera su
+ *   umbral y cumple si el extremo superior de las tres queda por debajo.
+ * - Duración de la réplica: se detiene cuando el semiancho de cada métrica es como mucho
+ *   'precision' veces su media o, si la media es menor que el umbral de QoS, el umbral.
+ *
+ * Al detenerse la réplica las métricas finales son las acumuladas hasta ese instante. Los
+ * intervalos deben ser lo bastante largos para que sus medias sean casi independientes; si
+ * no, el IC es demasiado estrecho y la parada se adelanta.
+ */
+class OutputAnalyzer
+{
+  public:
+    using Sampler = std::function<void(std::vector<FlowCounters>&)>;
+    // Histogramas de retardo y jitter de los paquetes de todos los usuarios hasta ahora
+    using SketchSampler = std::function<void(LatencySketch& delay, LatencySketch& jitter)>;
+
+    // Por qué terminó la réplica
+    enum Stop
+    {
+        RAN_TO_END,
+        QOS_MET,
+        QOS_FAILED,
+        PRECISION_REACHED
+    };
+
+    OutputAnalyzer(Sampler sampler,
+                   SketchSampler sketchSampler,
+                   Time trafficStart,
+                   Time trafficStop,
+                   const OutputAnalysisConfig& config)
+        : m_sampler(std::move(sampler)),
+          m_sketchSampler(std::move(sketchSampler)),
+          m_trafficStop(trafficStop),
+          m_config(config)
+    {
+        m_config.minWindows = std::max(2u, m_config.minWindows);
+        Simulator::Schedule(trafficStart + m_config.window - Simulator::Now(), &OutputAnalyzer::Check, this);
+    }
+
+    Stop StopReason() const
+    {
+        return m_stop;
+    }
+
+    // Tiempo simulado descartado como transitorio desde el arranque del tráfico
+    double WarmupSeconds() const
+    {
+        return m_config.warmup ? Truncation() * m_config.window.GetSeconds() : 0;
+    }
+
+    // Con 'warmup': métricas desde el final del transitorio hasta el instante actual. Devuelve
+    // false sin 'warmup' o si aún no hay intervalos; entonces valen las métricas habituales.
+    bool Metrics(double& lossRatio, double& avgDelayMs, double& avgJitterMs)
+    {
+        if (!m_config.warmup || m_intervals.empty())
+        {
+            return false;
+        }
+        m_sampler(m_current);
+        size_t d = Truncation();
+        static const std::vector<FlowCounters> none;
+        IntervalMetrics m = CountersDifference(d > 0 ? m_snapshots[d - 1] : none, m_current);
+        lossRatio = m.lossPercent;
+        avgDelayMs = m.delayMs;
+        avgJitterMs = m.jitterMs;
+        return true;
+    }
+
+    // Con 'warmup': contadores de cada flujo e histogramas de los usuarios al final del
+    // transitorio. Devuelve false (y los deja vacíos) sin 'warmup' o sin transitorio.
+    bool Transient(std::vector<FlowCounters>& flows, LatencySketch& delay, LatencySketch& jitter) const
+    {
+        size_t d = m_config.warmup ? Truncation() : 0;
+        if (d == 0)
+        {
+            return false;
+        }
+        flows = m_snapshots[d - 1];
+        delay = m_sketchSnapshots[d - 1].first;
+        jitter = m_sketchSnapshots[d - 1].second;
+        return true;
+    }
+
+    // Serie de intervalos en texto: fin del intervalo, retardo, jitter y pérdidas
+    void Write(const std::string& fileName) const
+    {
+        std::ofstream out(fileName);
+        size_t d = Truncation();
+        out << "# Intervalos de " << m_config.window.GetSeconds() << " s; transitorio: " << d << " intervalos";
+        if (d > 0)
+        {
+            out << " (hasta t=" << m_intervals[d - 1].endSeconds << " s)";
+        }
+        out << "\n# Fin(s) Retardo(ms) Jitter(ms) Perdidas(%)\n";
+        for (const auto& m : m_intervals)
+        {
+            out << m.endSeconds << " " << m.delayMs << " " << m.jitterMs << " " << m.lossPercent << "\n";
+        }
+    }
+
+  private:
+    // Intervalos descartados al principio de la serie
+    size_t Truncation() const
+    {
+        if (!m_config.warmup)
+        {
+            return std::min<size_t>(1, m_intervals.size());
+        }
+        std::vector<double> delay, jitter, loss;
+        for (const auto& m : m_intervals)
+        {
+            delay.push_back(m.delayMs);
+            jitter.push_back(m.jitterMs);
+            loss.push_back(m.lossPercent);
+        }
+        return std::max({MserTruncation(delay), MserTruncation(jitter), MserTruncation(loss)});
+    }
+
+    void Check()
+    {
+        m_sampler(m_current);
+        m_intervals.push_back(CountersDifference(m_previous, m_current));
+        if (m_config.warmup)
+        {
+            m_snapshots.push_back(m_current); // Para calcular las métricas desde cualquier intervalo
+            m_sketchSnapshots.emplace_back();
+            m_sketchSampler(m_sketchSnapshots.back().first, m_sketchSnapshots.back().second);
+        }
+        std::swap(m_previous, m_current);
+
+        size_t d = Truncation();
+        if (m_intervals.size() - d >= m_config.minWindows)
+        {
+            RunningStats delay, jitter, loss;
+            for (size_t i = d; i < m_intervals.size(); ++i)
+            {
+                delay.Add(m_intervals[i].delayMs);
+                jitter.Add(m_intervals[i].jitterMs);
+                loss.Add(m_intervals[i].lossPercent);
+            }
+            double t = StudentT975(delay.n - 1) / std::sqrt(static_cast<double>(delay.n));
+            auto lower = [t](const RunningStats& s) { return s.mean - t * s.StdDev(); };
+            auto upper = [t](const RunningStats& s) { return s.mean + t * s.StdDev(); };
+            auto precise = [this, t](const RunningStats& s, double threshold) {
+                return t * s.StdDev() <= m_config.precision * std::max(std::abs(s.mean), threshold);
+            };
+            if (m_config.earlyStop &&
+                (lower(delay) > MAX_DELAY_MS || lower(jitter) > MAX_JITTER_MS || lower(loss) > MAX_LOSS_PERCENT))
+            {
+                m_stop = QOS_FAILED;
+            }
+            else if (m_config.earlyStop &&
+                     upper(delay) < MAX_DELAY_MS && upper(jitter) < MAX_JITTER_MS && upper(loss) < MAX_LOSS_PERCENT)
+            {
+                m_stop = QOS_MET;
+            }
+            else if (m_config.precision > 0 && precise(delay, MAX_DELAY_MS) && precise(jitter, MAX_JITTER_MS) &&
+                     precise(loss, MAX_LOSS_PERCENT))
+            {
+                m_stop = PRECISION_REACHED;
+            }
+            if (m_stop != RAN_TO_END)
+            {
+                Simulator::Stop();
+                return;
+            }
+        }
+        if (Simulator::Now() + m_config.window <= m_trafficStop)
+        {
+            Simulator::Schedule(m_config.window, &OutputAnalyzer::Check, this);
+        }
+    }
+
+    Sampler m_sampler;
+    SketchSampler m_sketchSampler;
+    Time m_trafficStop;
+    OutputAnalysisConfig m_config;
+    std::vector<FlowCounters> m_previous;
+    std::vector<FlowCounters> m_current;
+    std::vector<IntervalMetrics> m_intervals;
+    std::vector<std::vector<FlowCounters>> m_snapshots; // Contadores al final de cada intervalo
+    std::vector<std::pair<LatencySketch, LatencySketch>> m_sketchSnapshots; // Histogramas, ídem
+    Stop m_stop = RAN_TO_END;
+};
+
+} // namespace ns3
+
+#endif // OUTPUT_ANALYSIS_H
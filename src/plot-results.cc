@@ -1,25 +1,290 @@
+#include "ns3/command-line.h"
 #include "ns3/gnuplot.h"
+#include "qos-stats.h"
+#include "queue-trace.h"
+#include "response-surface.h"
+#include "results-store.h"
+#include <sys/stat.h>
+#include <unistd.h>
 #include <algorithm> // Necesario para std::sort
 #include <cmath>     // Necesario para sqrt y pow
+#include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iomanip> // Necesario para std::fixed y std::setprecision
 #include <iostream>
 #include <map>
-#include <numeric> // Necesario para std::accumulate
+#include <sstream>
 #include <string>
 #include <vector>
 
 using namespace ns3;
 
-// Estructura para almacenar las  muestras de cada métrica
-struct MetricSamples
+// Acumuladores de las tres métricas de una celda (usuarios, bitrate)
+struct CellStats
 {
-    std::vector<double> lossSamples;
-    std::vector<double> delaySamples;
-    std::vector<double> jitterSamples;
+    RunningStats loss;
+    RunningStats delay;
+    RunningStats jitter;
+    // Distribución por usuario (solo registros del esquema 3 o posterior)
+    RunningStats usersOk;   // Fracción de usuarios que cumple los tres umbrales
+    RunningStats delayP95;  // Percentil 95 del retardo de los paquetes (ms)
+    // Cachés de borde (solo registros del esquema 4 o posterior con --edgeCache)
+    RunningStats edgeHitRatio; // Fracción de las sesiones servidas por las cachés
 };
 
+// --- ÍNDICE DE RESUMEN PERSISTENTE ---
+// <resultsFile>.idx guarda los acumuladores de todas las celdas y hasta qué byte del fichero de
+// resultados se han procesado, de modo que cada ejecución solo lee las filas añadidas desde la
+// anterior. Para detectar que el fichero se ha borrado o reescrito se guarda también un hash
+// de sus primeros bytes; si no coincide, o el fichero es más corto, el índice se reconstruye.
+// Las celdas son siempre de una sola configuración del modelo (configHash de los registros):
+// la de todo el fichero o la elegida con --config, que usa su propio índice.
+const uint32_t SUMMARY_INDEX_VERSION = 4;
+const size_t SUMMARY_FINGERPRINT_BYTES = 4096;
+
+struct SummaryIndexHeader
+{
+    char magic[8]; // "SNSUMIDX"
+    uint32_t version;
+    uint32_t numCells;
+    uint64_t consumedBytes; // Bytes del fichero de resultados ya acumulados
+    uint64_t fingerprint;   // Fnv1a64 de los primeros bytes del fichero de resultados
+    uint64_t configHash;    // Configuración de las celdas (0 en los ficheros de texto)
+};
+
+struct SummaryIndexCell
+{
+    uint32_t users;
+    uint32_t reserved;
+    double bitrate;
+    CellStats stats;
+};
+
+static_assert(sizeof(SummaryIndexHeader) == 40, "SummaryIndexHeader debe ocupar 40 bytes");
+
+using CellMap = std::map<int, std::map<double, CellStats>>;
+
+// Hash de los primeros min(length, SUMMARY_FINGERPRINT_BYTES) bytes de un fichero
+uint64_t
+FileFingerprint(const std::string& fileName, uint64_t length)
+{
+    std::string head(std::min<uint64_t>(length, SUMMARY_FINGERPRINT_BYTES), '\0');
+    std::ifstream in(fileName, std::ios::binary);
+    in.read(&head[0], head.size());
+    head.resize(in.gcount());
+    return Fnv1a64(head);
+}
+
+// Carga el índice si sigue siendo válido para el fichero de resultados; si no, deja las celdas vacías
+uint64_t
+LoadSummaryIndex(const std::string& indexFile, const std::string& resultsFile, CellMap& cells, uint64_t& configHash)
+{
+    std::ifstream in(indexFile, std::ios::binary);
+    SummaryIndexHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, "SNSUMIDX", 8) != 0 || header.version != SUMMARY_INDEX_VERSION)
+    {
+        return 0;
+    }
+    struct stat st;
+    if (stat(resultsFile.c_str(), &st) != 0 || static_cast<uint64_t>(st.st_size) < header.consumedBytes ||
+        FileFingerprint(resultsFile, header.consumedBytes) != header.fingerprint)
+    {
+        std::cout << "El índice " << indexFile << " no corresponde a " << resultsFile << ": se reconstruye."
+                  << std::endl;
+        return 0;
+    }
+    SummaryIndexCell cell;
+    for (uint32_t i = 0; i < header.numCells; ++i)
+    {
+        if (!in.read(reinterpret_cast<char*>(&cell), sizeof(cell)))
+        {
+            cells.clear();
+            return 0;
+        }
+        cells[cell.users][cell.bitrate] = cell.stats;
+    }
+    configHash = header.configHash;
+    return header.consumedBytes;
+}
+
+// Escribe el índice en un temporal y lo renombra, para no dejarlo a medias si se interrumpe
+void
+SaveSummaryIndex(const std::string& indexFile,
+                 const std::string& resultsFile,
+                 const CellMap& cells,
+                 uint64_t consumed,
+                 uint64_t configHash)
+{
+    SummaryIndexHeader header{};
+    std::memcpy(header.magic, "SNSUMIDX", 8);
+    header.version = SUMMARY_INDEX_VERSION;
+    header.consumedBytes = consumed;
+    header.fingerprint = FileFingerprint(resultsFile, consumed);
+    header.configHash = configHash;
+    for (const auto& [users, row] : cells)
+    {
+        header.numCells += row.size();
+    }
+
+    std::string tmp = indexFile + ".tmp." + std::to_string(getpid());
+    std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& [users, row] : cells)
+    {
+        for (const auto& [bitrate, stats] : row)
+        {
+            SummaryIndexCell cell{static_cast<uint32_t>(users), 0, bitrate, stats};
+            out.write(reinterpret_cast<const char*>(&cell), sizeof(cell));
+        }
+    }
+    out.close();
+    if (!out || std::rename(tmp.c_str(), indexFile.c_str()) != 0)
+    {
+        std::cerr << "Aviso: no se pudo guardar el índice " << indexFile << "." << std::endl;
+        std::remove(tmp.c_str());
+    }
+}
+
+// Acumula las filas del fichero de resultados a partir del byte 'offset' y devuelve hasta
+// dónde ha leído. Solo se consumen registros o líneas completos: si un escritor está a mitad
+// de añadir uno, se leerá en la siguiente ejecución.
+// Con 'selected' solo se acumulan los registros de la configuración 'configHash'; sin él,
+// 'configHash' toma la de los primeros registros y 'mixed' se activa (sin acumular nada más)
+// en cuanto aparece otra, porque mezclar configuraciones en una celda no tiene sentido.
+uint64_t
+AccumulateResults(const std::string& resultsFile,
+                  uint64_t offset,
+                  bool selected,
+                  uint64_t& configHash,
+                  CellMap& cells,
+                  size_t& newRows,
+                  bool& mixed)
+{
+    auto add = [&](int users, double bitrate, double loss, double delay, double jitter) -> CellStats& {
+        CellStats& c = cells[users][bitrate];
+        c.loss.Add(loss);
+        c.delay.Add(delay);
+        c.jitter.Add(jitter);
+        ++newRows;
+        return c;
+    };
+
+    MappedResults results(resultsFile);
+    if (results.IsValid())
+    {
+        uint64_t first = offset > sizeof(ResultsFileHeader) ? (offset - sizeof(ResultsFileHeader)) / results.RecordSize() : 0;
+        bool perUser = results.RecordSize() >= RESULT_RECORD_SIZES[3];
+        bool edgeCache = results.RecordSize() >= RESULT_RECORD_SIZES[4];
+        bool known = selected || !cells.empty();
+        for (size_t i = std::min<uint64_t>(first, results.Size()); i < results.Size(); ++i)
+        {
+            ResultRecord r = results[i];
+            if (!known)
+            {
+                configHash = r.configHash;
+                known = true;
+            }
+            if (r.configHash != configHash)
+            {
+                if (selected)
+                {
+                    continue;
+                }
+                mixed = true;
+                return offset;
+            }
+            CellStats& c = add(r.users, r.bitrateMbps, r.lossRatio, r.delayMs, r.jitterMs);
+            if (perUser)
+            {
+                c.usersOk.Add(r.usersOk);
+                c.delayP95.Add(r.delayP95Ms);
+            }
+            if (edgeCache && r.edgeHitRatio > 0)
+            {
+                c.edgeHitRatio.Add(r.edgeHitRatio);
+            }
+        }
+        return sizeof(ResultsFileHeader) + results.Size() * results.RecordSize();
+    }
+
+    // Formato de texto anterior (results.dat); main() ya ha rechazado cualquier otro contenido
+    std::ifstream inFile(resultsFile);
+    inFile.seekg(offset);
+    std::string line;
+    while (std::getline(inFile, line) && !inFile.eof())
+    {
+        std::istringstream fields(line);
+        int numUsers;
+        double tempBitrate, tempLoss, tempDelay, tempJitter;
+        if (fields >> numUsers >> tempBitrate >> tempLoss >> tempDelay >> tempJitter)
+        {
+            add(numUsers, tempBitrate, tempLoss, tempDelay, tempJitter);
+        }
+        offset += line.size() + 1;
+    }
+    return offset;
+}
+
+// Registros de cada configuración en todo el fichero binario
+std::map<uint64_t, size_t>
+CountConfigs(const std::string& resultsFile)
+{
+    std::map<uint64_t, size_t> counts;
+    MappedResults results(resultsFile);
+    for (size_t i = 0; results.IsValid() && i < results.Size(); ++i)
+    {
+        ++counts[results[i].configHash];
+    }
+    return counts;
+}
+
+// Lista las configuraciones del fichero con sus registros y su descripción (<fichero>.configs)
+void
+PrintConfigs(const std::string& resultsFile, const std::map<uint64_t, size_t>& counts)
+{
+    std::map<uint64_t, std::string> catalogue = ReadConfigCatalogue(resultsFile);
+    for (const auto& [hash, n] : counts)
+    {
+        auto described = catalogue.find(hash);
+        std::cerr << "  " << ConfigHashHex(hash) << "  " << n << " réplicas  "
+                  << (described != catalogue.end() ? described->second : "(sin descripción)") << std::endl;
+    }
+}
+
+// --config: un prefijo hexadecimal del hash (4 cifras o más) o un fragmento de la descripción
+// que identifique una sola de las configuraciones del fichero
+bool
+SelectConfig(const std::string& resultsFile, const std::string& selector, uint64_t& configHash)
+{
+    std::map<uint64_t, size_t> counts = CountConfigs(resultsFile);
+    std::map<uint64_t, std::string> catalogue = ReadConfigCatalogue(resultsFile);
+    bool hex = selector.size() >= 4 && selector.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos;
+    std::vector<uint64_t> matches;
+    for (const auto& [hash, n] : counts)
+    {
+        std::string lower = selector;
+        std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+        auto described = catalogue.find(hash);
+        if ((hex && ConfigHashHex(hash).rfind(lower, 0) == 0) ||
+            (described != catalogue.end() && described->second.find(selector) != std::string::npos))
+        {
+            matches.push_back(hash);
+        }
+    }
+    if (matches.size() != 1)
+    {
+        std::cerr << "Error: --config=" << selector << (matches.empty() ? " no coincide con ninguna" : " coincide con varias")
+                  << " de las configuraciones de " << resultsFile << ":" << std::endl;
+        PrintConfigs(resultsFile, counts);
+        return false;
+    }
+    configHash = matches.front();
+    return true;
+}
+
 // Estructura para almacenar los resultados ya procesados (media y margen de error)
 struct ProcessedPoint
 {
@@ -30,6 +295,10 @@ struct ProcessedPoint
     double delayMarginOfError;
     double jitterMean;
     double jitterMarginOfError;
+    double usersOkMean; // Fracción de usuarios que cumple los tres umbrales (-1 sin datos por usuario)
+    double usersOkMarginOfError;
+    double delayP95Mean;
+    double edgeHitMean; // Fracción de sesiones servidas por las cachés de borde (-1 sin cachés)
 };
 
 // Función para ejecutar un comando del sistema
@@ -42,100 +311,382 @@ ExecuteCommand(const std::string& command)
     }
 }
 
-// Función para calcular la media
-double
-CalculateMean(const std::vector<double>& samples)
+// Genera una gráfica de una serie temporal de la cola con uno o varios campos de las muestras
+void
+PlotQueueSeries(const std::string& fileName,
+                const std::string& title,
+                const std::string& yLabel,
+                const std::vector<QueueSample>& samples,
+                const std::vector<std::pair<std::string, double (*)(const QueueSample&)>>& series)
 {
-    if (samples.empty())
+    Gnuplot plot(fileName + ".png");
+    plot.SetTitle(title);
+    plot.SetTerminal("pngcairo enhanced font 'Helvetica,12' size 1200,500");
+    plot.SetLegend("Tiempo (s)", yLabel);
+    plot.SetExtra("set grid;");
+    for (const auto& [name, field] : series)
     {
-        return 0.0;
+        Gnuplot2dDataset dataset;
+        dataset.SetStyle(Gnuplot2dDataset::LINES);
+        dataset.SetTitle(name);
+        for (const auto& s : samples)
+        {
+            dataset.Add(s.timeS, field(s));
+        }
+        plot.AddDataset(dataset);
     }
-    double sum = std::accumulate(samples.begin(), samples.end(), 0.0);
-    return sum / samples.size();
+    std::ofstream plotFile(fileName + ".plt");
+    plot.GenerateOutput(plotFile);
+    plotFile.close();
+    ExecuteCommand("gnuplot " + fileName + ".plt");
+    ExecuteCommand("rm -f " + fileName + ".plt");
 }
 
-// Funciones para calcular la desviación estándar y el margen de error del 95%
-double
-CalculateStdDev(const std::vector<double>& samples, double mean)
+// Gráficas de la serie temporal de la cola cuello de botella escrita con --queueTrace
+int
+PlotQueueTrace(const std::string& traceFile, const std::string& dir)
 {
-    if (samples.size() < 2)
+    QueueTraceHeader header;
+    std::vector<QueueSample> samples;
+    if (!ReadQueueTrace(traceFile, header, samples))
     {
-        return 0.0;
+        std::cerr << "Error: No se puede leer la serie temporal de la cola " << traceFile << "." << std::endl;
+        return 1;
     }
-    double sq_sum = 0.0;
+
+    std::string base = traceFile.substr(traceFile.find_last_of('/') + 1);
+    base = base.substr(0, base.rfind(".qts"));
+    std::string prefix = dir + "/cola_" + base;
+    std::ostringstream caso;
+    caso << " (" << header.users << " usuarios, " << header.bitrateMbps << " Mbps)";
+
+    PlotQueueSeries(prefix + "_ocupacion", "Ocupacion de la cola router1-router2" + caso.str(), "Paquetes en cola", samples,
+                    {{"Paquetes", [](const QueueSample& s) { return double(s.packets); }},
+                     {"Descartes en el intervalo", [](const QueueSample& s) { return double(s.drops); }}});
+    PlotQueueSeries(prefix + "_permanencia", "Tiempo en cola" + caso.str(), "Tiempo en cola (ms)", samples,
+                    {{"Medio", [](const QueueSample& s) { return double(s.sojournMeanMs); }},
+                     {"Maximo", [](const QueueSample& s) { return double(s.sojournMaxMs); }}});
+    PlotQueueSeries(prefix + "_utilizacion", "Utilizacion del enlace" + caso.str(), "Utilizacion (porcentaje)", samples,
+                    {{"Utilizacion", [](const QueueSample& s) { return 100.0 * s.utilisation; }}});
+
+    // Resumen: tiempo total con cola por encima de la mitad de su pico
+    uint32_t peak = 0;
     for (const auto& s : samples)
     {
-        sq_sum += std::pow(s - mean, 2);
+        peak = std::max(peak, s.packets);
+    }
+    uint32_t busy = std::count_if(samples.begin(), samples.end(), [peak](const QueueSample& s) {
+        return peak > 0 && s.packets * 2 >= peak;
+    });
+    std::cout << "Serie " << traceFile << ": " << samples.size() << " muestras cada " << header.intervalS * 1000
+              << " ms, pico de " << peak << " paquetes, " << busy * header.intervalS
+              << " s con la cola por encima de la mitad del pico." << std::endl;
+    std::cout << "Gráficas generadas en " << prefix << "_*.png" << std::endl;
+    return 0;
+}
+
+// --- MODELO SUSTITUTO (--predict, --suggest) ---
+
+// Lee un resumen sim_precision.dat (medias y semianchos del IC del 95% por celda). Sin el
+// número de réplicas, la varianza de cada media se aproxima por (semiancho / 1.96)².
+bool
+ReadSummaryFile(const std::string& fileName, std::vector<SurrogateCell>& cells)
+{
+    std::ifstream in(fileName);
+    std::string line;
+    if (!std::getline(in, line))
+    {
+        return false;
+    }
+    auto variance = [](double margin) { return std::pow(margin / 1.96, 2); };
+    while (std::getline(in, line))
+    {
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        double users, bitrate, delay, delayMargin, jitter, jitterMargin, loss, lossMargin;
+        if (fields >> users >> bitrate >> delay >> delayMargin >> jitter >> jitterMargin >> loss >> lossMargin)
+        {
+            cells.push_back({users, bitrate, delay, variance(delayMargin), jitter, variance(jitterMargin), loss,
+                             variance(lossMargin)});
+        }
+    }
+    return !cells.empty();
+}
+
+// Lista de números separados por comas ("275,300")
+std::vector<double>
+ParseNumberList(const std::string& text)
+{
+    std::vector<double> values;
+    std::istringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ','))
+    {
+        if (!item.empty())
+        {
+            values.push_back(std::stod(item));
+        }
     }
-    return std::sqrt(sq_sum / (samples.size() - 1));
+    return values;
 }
 
-double
-CalculateMarginOfError(double stdDev, int sampleSize)
+// Ajusta las superficies de respuesta y responde a las consultas de bitrate requerido para
+// 'predictUsers' y, si 'suggest' > 0, propone los siguientes puntos a simular
+int
+RunSurrogate(const std::vector<SurrogateCell>& cells,
+             const std::vector<double>& predictUsers,
+             const QosThresholds& qos,
+             uint32_t suggest,
+             double step)
 {
-    if (sampleSize < 2)
-        return 0.0;
-    const double T_VALUE_95_10_SAMPLES = 2.262; // Valor crítico de t-Student para 95% y n=10
-    return T_VALUE_95_10_SAMPLES * stdDev / std::sqrt(sampleSize);
+    if (cells.size() < 4)
+    {
+        std::cerr << "Error: hacen falta al menos 4 celdas (usuarios, bitrate) para ajustar el modelo sustituto." << std::endl;
+        return 1;
+    }
+    QosSurrogate surrogate;
+    surrogate.Fit(cells);
+    std::cout << "Modelo sustituto ajustado a " << cells.size() << " celdas. Longitudes de correlación (usuarios, "
+              << "log Mbps/usuario): retardo " << surrogate.Delay().UserLength() << ", " << surrogate.Delay().CapacityLength()
+              << "; jitter " << surrogate.Jitter().UserLength() << ", " << surrogate.Jitter().CapacityLength() << "; pérdida "
+              << surrogate.Loss().UserLength() << ", " << surrogate.Loss().CapacityLength() << std::endl;
+    std::cout << "Umbrales: retardo " << qos.delayMs << " ms, jitter " << qos.jitterMs << " ms, pérdida " << qos.lossPercent
+              << " %" << std::endl;
+
+    std::cout << "\n--- Bitrate requerido según el modelo (IC 95%) ---\n";
+    for (double users : predictUsers)
+    {
+        double low = surrogate.RequiredBitrate(users, qos, 0.025, step);
+        double mid = surrogate.RequiredBitrate(users, qos, 0.5, step);
+        double high = surrogate.RequiredBitrate(users, qos, 0.975, step);
+        std::cout << "Para " << users << " usuarios: ";
+        if (mid < 0)
+        {
+            std::cout << "ningún bitrate del rango simulado cumple la QoS";
+            if (low >= 0)
+            {
+                std::cout << " con probabilidad >= 0.5 (cumpliría con 0.025 desde " << low << " Mbps)";
+            }
+        }
+        else
+        {
+            double delay, jitter, loss;
+            surrogate.Predict(users, mid, delay, jitter, loss);
+            std::cout << "bitrate requerido " << mid << " Mbps [" << low << ", ";
+            if (high < 0)
+            {
+                std::cout << "> máximo simulado";
+            }
+            else
+            {
+                std::cout << high;
+            }
+            std::cout << "] (retardo " << std::fixed << std::setprecision(2) << delay << " ms, jitter " << jitter
+                      << " ms, pérdida " << loss << " %)" << std::defaultfloat << std::setprecision(6);
+        }
+        if (!surrogate.InRange(users))
+        {
+            std::cout << " [extrapolado: fuera del rango de usuarios simulado]";
+        }
+        std::cout << std::endl;
+    }
+
+    if (suggest > 0)
+    {
+        // Rejilla de candidatos: la mitad del menor paso de usuarios simulado
+        std::vector<double> users;
+        for (const SurrogateCell& c : cells)
+        {
+            users.push_back(c.users);
+        }
+        std::sort(users.begin(), users.end());
+        users.erase(std::unique(users.begin(), users.end()), users.end());
+        double userStep = users.back() - users.front();
+        for (size_t i = 1; i < users.size(); ++i)
+        {
+            userStep = std::min(userStep, users[i] - users[i - 1]);
+        }
+        userStep = std::max(std::round(userStep / 2), 1.0);
+
+        std::cout << "\n--- Siguientes puntos a simular (frontera de QoS más incierta) ---\n";
+        for (const auto& s : surrogate.Suggest(suggest, qos, userStep, step))
+        {
+            std::cout << "  --num_usuarios=" << s.users << " --bitrate=" << s.bitrate << "Mbps  (P(cumple) = " << std::fixed
+                      << std::setprecision(2) << s.probability << ")" << std::defaultfloat << std::setprecision(6) << std::endl;
+        }
+    }
+    return 0;
 }
 
 int
 main(int argc, char* argv[])
 {
-    // --- UMBRALES DE CALIDAD DE SERVICIO (QoS) ---
-    const double MAX_DELAY_MS = 20.0;
-    const double MAX_JITTER_MS = 8.0;
-    const double MAX_LOSS_PERCENT = 0.5;
+    std::string queueTrace = "";
+    std::string resultsFile = "results.bin";
+    std::string toText = "";
+    std::string fromText = "";
+    bool rebuildIndex = false;
+    std::string predict = "";
+    std::string thresholds = "";
+    uint32_t suggest = 0;
+    std::string surrogateSummary = "";
+    double surrogateStep = 0.5;
+    double sla = 0.0;
+    std::string config = "";
+    std::string label = "";
+    CommandLine cmd;
+    cmd.AddValue("queueTrace", "Fichero .qts de onoffRouting --queueTrace a representar (en lugar de results.dat)", queueTrace);
+    cmd.AddValue("resultsFile", "Fichero de resultados a leer (binario, o texto si acaba en .dat)", resultsFile);
+    cmd.AddValue("toText", "Convierte resultsFile (binario) a este fichero de texto y termina", toText);
+    cmd.AddValue("rebuildIndex", "Ignora el índice de resumen <resultsFile>.idx y lo reconstruye desde cero", rebuildIndex);
+    cmd.AddValue("fromText", "Convierte este fichero de texto a resultsFile (binario) y termina", fromText);
+    cmd.AddValue("predict", "Modelo sustituto: usuarios (separados por comas) para los que estimar el bitrate requerido", predict);
+    cmd.AddValue("thresholds", "Modelo sustituto: umbrales 'retardo_ms,jitter_ms,pérdida_%' (por defecto los de qos-stats.h)", thresholds);
+    cmd.AddValue("suggest", "Modelo sustituto: número de puntos (usuarios, bitrate) a proponer para la siguiente simulación", suggest);
+    cmd.AddValue("surrogateSummary", "Modelo sustituto: ajustar a este resumen sim_precision.dat en lugar de a resultsFile", surrogateSummary);
+    cmd.AddValue("surrogateStep", "Modelo sustituto: paso de bitrate (Mbps) de las consultas y de los candidatos", surrogateStep);
+    cmd.AddValue("sla", "Modo SLA: el bitrate requerido es el primero en que esta fracción de los usuarios (media de las réplicas) cumple los tres umbrales, p. ej. 0.95 (0 = criterio de las medias)", sla);
+    cmd.AddValue("config", "Configuración del modelo a representar cuando resultsFile tiene varias: prefijo de su hash o fragmento de su descripción", config);
+    cmd.AddValue("label", "Sufijo de los directorios de gráficas, de sim_precision.dat y del título final (por defecto, el hash de --config)", label);
+    cmd.Parse(argc, argv);
+
+    // --- CONVERSIÓN ENTRE FORMATOS ---
+    if (!toText.empty())
+    {
+        size_t n = ConvertBinaryToText(resultsFile, toText);
+        std::cout << n << " réplicas de " << resultsFile << " escritas en " << toText << std::endl;
+        return 0;
+    }
+    if (!fromText.empty())
+    {
+        size_t n = ConvertTextToBinary(fromText, resultsFile);
+        std::cout << n << " réplicas de " << fromText << " añadidas a " << resultsFile << std::endl;
+        return 0;
+    }
+
+    // --- CONFIGURACIÓN A REPRESENTAR ---
+    uint64_t configHash = 0;
+    if (!config.empty() && queueTrace.empty())
+    {
+        std::string reason;
+        if (ClassifyResultsFile(resultsFile, reason) != ResultsFileKind::BINARY)
+        {
+            std::cerr << "Error: --config solo se aplica a ficheros binarios de resultados." << std::endl;
+            return 1;
+        }
+        if (!SelectConfig(resultsFile, config, configHash))
+        {
+            return 1;
+        }
+        if (label.empty())
+        {
+            label = ConfigHashHex(configHash).substr(0, 8);
+        }
+    }
+    std::string suffix = label.empty() ? "" : "-" + label;
 
     // --- CREAR DIRECTORIOS ---
-    const char* dir = "graficas";
-    const char* precision_dir = "graficas-precision";
-    ExecuteCommand("mkdir -p " + std::string(dir));
-    ExecuteCommand("mkdir -p " + std::string(precision_dir));
+    std::string dir = "graficas" + suffix;
+    std::string precision_dir = "graficas-precision" + suffix;
+    ExecuteCommand("mkdir -p " + dir);
+    ExecuteCommand("mkdir -p " + precision_dir);
+
+    if (!queueTrace.empty())
+    {
+        return PlotQueueTrace(queueTrace, dir);
+    }
+
+    bool surrogateMode = !predict.empty() || suggest > 0;
+    QosThresholds qos;
+    if (!thresholds.empty())
+    {
+        std::vector<double> values = ParseNumberList(thresholds);
+        if (values.size() != 3)
+        {
+            std::cerr << "Error: --thresholds espera 'retardo_ms,jitter_ms,pérdida_%'." << std::endl;
+            return 1;
+        }
+        qos = {values[0], values[1], values[2]};
+    }
+    if (surrogateMode && !surrogateSummary.empty())
+    {
+        std::vector<SurrogateCell> cells;
+        if (!ReadSummaryFile(surrogateSummary, cells))
+        {
+            std::cerr << "Error: No se puede leer el resumen " << surrogateSummary << "." << std::endl;
+            return 1;
+        }
+        return RunSurrogate(cells, ParseNumberList(predict), qos, suggest, surrogateStep);
+    }
 
-    // --- LECTURA DEL FICHERO DE DATOS ---
-    std::map<int, std::map<double, MetricSamples>> dataByUsersAndBitrate;
-    std::ifstream inFile("results.dat");
-    if (!inFile)
+    // --- LECTURA INCREMENTAL DEL FICHERO DE DATOS ---
+    if (access(resultsFile.c_str(), R_OK) != 0)
+    {
+        std::cerr << "Error: No se puede abrir el fichero " << resultsFile << "." << std::endl;
+        return 1;
+    }
+    std::string unsupported;
+    if (ClassifyResultsFile(resultsFile, unsupported) == ResultsFileKind::UNSUPPORTED)
     {
-        std::cerr << "Error: No se puede abrir el fichero results.dat." << std::endl;
+        std::cerr << "Error: No se puede leer " << resultsFile << ": " << unsupported << "." << std::endl;
         return 1;
     }
+    // Cada configuración elegida con --config tiene su índice: <resultsFile>.<hash>.idx
+    std::string indexFile = resultsFile + (config.empty() ? "" : "." + ConfigHashHex(configHash)) + ".idx";
+    CellMap cells;
+    uint64_t indexHash = configHash;
+    uint64_t consumed = rebuildIndex ? 0 : LoadSummaryIndex(indexFile, resultsFile, cells, indexHash);
+    if (!config.empty() && indexHash != configHash)
+    {
+        cells.clear();
+        consumed = 0;
+    }
+    size_t newRows = 0;
+    bool mixed = false;
+    consumed = AccumulateResults(resultsFile, consumed, !config.empty(), indexHash, cells, newRows, mixed);
+    if (mixed)
+    {
+        std::cerr << "Error: " << resultsFile << " mezcla varias configuraciones del modelo; elija una con --config=<hash o descripción>:"
+                  << std::endl;
+        PrintConfigs(resultsFile, CountConfigs(resultsFile));
+        return 1;
+    }
+    SaveSummaryIndex(indexFile, resultsFile, cells, consumed, indexHash);
+    std::cout << newRows << " filas nuevas acumuladas en " << indexFile << "." << std::endl;
 
-    int numUsers;
-    double tempBitrate, tempLoss, tempDelay, tempJitter;
-    while (inFile >> numUsers >> tempBitrate >> tempLoss >> tempDelay >> tempJitter)
+    if (surrogateMode)
     {
-        dataByUsersAndBitrate[numUsers][tempBitrate].lossSamples.push_back(tempLoss);
-        dataByUsersAndBitrate[numUsers][tempBitrate].delaySamples.push_back(tempDelay);
-        dataByUsersAndBitrate[numUsers][tempBitrate].jitterSamples.push_back(tempJitter);
+        std::vector<SurrogateCell> surrogateCells;
+        for (const auto& [users, row] : cells)
+        {
+            for (const auto& [bitrate, stats] : row)
+            {
+                auto variance = [](const RunningStats& r) { return r.n < 2 ? 0.0 : std::pow(r.StdDev(), 2) / r.n; };
+                surrogateCells.push_back({double(users), bitrate, stats.delay.mean, variance(stats.delay), stats.jitter.mean,
+                                          variance(stats.jitter), stats.loss.mean, variance(stats.loss)});
+            }
+        }
+        return RunSurrogate(surrogateCells, ParseNumberList(predict), qos, suggest, surrogateStep);
     }
-    inFile.close();
 
     // --- CÁLCULO ESTADÍSTICO Y PREPARACIÓN DE DATOS ---
     std::map<int, std::vector<ProcessedPoint>> processedDataByUserCount;
-    for (auto const& [users, bitrateData] : dataByUsersAndBitrate)
+    for (auto const& [users, bitrateData] : cells)
     {
-        for (auto const& [bitrate, samples] : bitrateData)
+        for (auto const& [bitrate, stats] : bitrateData)
         {
             ProcessedPoint p_point;
             p_point.bitrate = bitrate;
-
-            p_point.delayMean = CalculateMean(samples.delaySamples);
-            double delayStdDev = CalculateStdDev(samples.delaySamples, p_point.delayMean);
-            p_point.delayMarginOfError =
-                CalculateMarginOfError(delayStdDev, samples.delaySamples.size());
-
-            p_point.jitterMean = CalculateMean(samples.jitterSamples);
-            double jitterStdDev = CalculateStdDev(samples.jitterSamples, p_point.jitterMean);
-            p_point.jitterMarginOfError =
-                CalculateMarginOfError(jitterStdDev, samples.jitterSamples.size());
-
-            p_point.lossMean = CalculateMean(samples.lossSamples);
-            double lossStdDev = CalculateStdDev(samples.lossSamples, p_point.lossMean);
-            p_point.lossMarginOfError =
-                CalculateMarginOfError(lossStdDev, samples.lossSamples.size());
-
+            p_point.delayMean = stats.delay.mean;
+            p_point.delayMarginOfError = stats.delay.MarginOfError();
+            p_point.jitterMean = stats.jitter.mean;
+            p_point.jitterMarginOfError = stats.jitter.MarginOfError();
+            p_point.lossMean = stats.loss.mean;
+            p_point.lossMarginOfError = stats.loss.MarginOfError();
+            p_point.usersOkMean = stats.usersOk.n > 0 ? stats.usersOk.mean : -1;
+            p_point.usersOkMarginOfError = stats.usersOk.MarginOfError();
+            p_point.delayP95Mean = stats.delayP95.mean;
+            p_point.edgeHitMean = stats.edgeHitRatio.n > 0 ? stats.edgeHitRatio.mean : -1;
             processedDataByUserCount[users].push_back(p_point);
         }
     }
@@ -146,6 +697,24 @@ main(int argc, char* argv[])
         return 1;
     }
 
+    if (sla > 0)
+    {
+        bool perUser = false;
+        for (const auto& [users, points] : processedDataByUserCount)
+        {
+            for (const auto& p : points)
+            {
+                perUser = perUser || p.usersOkMean >= 0;
+            }
+        }
+        if (!perUser)
+        {
+            std::cerr << "Error: --sla necesita la QoS por usuario, que solo guardan los resultados del esquema 3 o posterior."
+                      << std::endl;
+            return 1;
+        }
+    }
+
     // Ordenar los puntos por bitrate
     double minBitrate = 1e9, maxBitrate = 0;
     for (auto& pair : processedDataByUserCount)
@@ -165,14 +734,15 @@ main(int argc, char* argv[])
     }
 
     // --- LÓGICA PARA ENCONTRAR EL BITRATE MÍNIMO ---
+    // Con --sla se aprovisiona por percentil de usuarios en lugar de por la media de las métricas
     std::vector<std::pair<int, ProcessedPoint>> finalResults;
     for (auto const& [users, points] : processedDataByUserCount)
     {
-        ProcessedPoint bestPoint = {-1, -1, -1, -1, -1, -1, -1};
+        ProcessedPoint bestPoint = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
         for (const auto& point : points)
         {
-            if (point.delayMean <= MAX_DELAY_MS && point.jitterMean <= MAX_JITTER_MS &&
-                point.lossMean <= MAX_LOSS_PERCENT)
+            bool meets = sla > 0 ? point.usersOkMean >= sla : MeetsQos(point.delayMean, point.jitterMean, point.lossMean);
+            if (meets)
             {
                 bestPoint = point;
                 break;
@@ -182,9 +752,10 @@ main(int argc, char* argv[])
     }
 
     // --- GENERACIÓN DE FICHERO CSV CON RESUMEN ESTADÍSTICO ---
-    std::ofstream summaryFile("sim_precision.dat");
+    std::string summaryFileName = "sim_precision" + suffix + ".dat";
+    std::ofstream summaryFile(summaryFileName);
     summaryFile << "Usuarios,Bitrate,LatenciaMedia,LatenciaError95,JitterMedio,JitterError95,"
-                   "PerdidaMedia,PerdidaError95\n";
+                   "PerdidaMedia,PerdidaError95,UsuariosQoS,UsuariosQoSError95,LatenciaP95,AciertosCache\n";
     for (auto const& [users, points] : processedDataByUserCount)
     {
         for (const auto& p : points)
@@ -192,15 +763,16 @@ main(int argc, char* argv[])
             summaryFile << users << "," << p.bitrate << "," << p.delayMean << ","
                         << p.delayMarginOfError << "," << p.jitterMean << ","
                         << p.jitterMarginOfError << "," << p.lossMean << ","
-                        << p.lossMarginOfError << "\n";
+                        << p.lossMarginOfError << "," << p.usersOkMean << ","
+                        << p.usersOkMarginOfError << "," << p.delayP95Mean << "," << p.edgeHitMean << "\n";
         }
     }
     summaryFile.close();
-    std::cout << "Fichero con resumen estadístico 'sim_precision.dat' generado correctamente."
+    std::cout << "Fichero con resumen estadístico '" << summaryFileName << "' generado correctamente."
               << std::endl;
 
     // --- GENERACIÓN DE GRÁFICAS DETALLADAS ---
-    std::string file_prefix_detailed = std::string(dir) + "/grafica_ns3";
+    std::string file_prefix_detailed = dir + "/grafica_ns3";
 
     // Gráfica de Retardo
     Gnuplot plotRetardo(file_prefix_detailed + "_retardo_detallado.png");
@@ -297,7 +869,7 @@ main(int argc, char* argv[])
     ExecuteCommand("rm -f " + file_prefix_detailed + "_perdida_detallada.plt");
 
     // --- GENERACIÓN DE GRÁFICAS DE PRECISIÓN ---
-    std::string precision_prefix = std::string(precision_dir) + "/grafica_precision";
+    std::string precision_prefix = precision_dir + "/grafica_precision";
 
     // Gráfica de Precisión del Retardo
     Gnuplot plotDelayError(precision_prefix + "_retardo.png");
@@ -369,10 +941,12 @@ main(int argc, char* argv[])
     ExecuteCommand("rm -f " + precision_prefix + "_perdida.plt");
 
     // --- GRÁFICA FINAL DE RESULTADOS ---
-    std::string finalPlotFileName = std::string(dir) + "/grafica_ns3_final_bitrate_requerido.png";
+    std::string finalPlotFileName = dir + "/grafica_ns3_final_bitrate_requerido.png";
     Gnuplot2dDataset finalDataset;
     finalDataset.SetStyle(Gnuplot2dDataset::LINES_POINTS);
-    finalDataset.SetTitle("Bitrate Requerido");
+    std::string finalTitle = label.empty() ? "Bitrate Requerido" : "Bitrate Requerido [" + label + "]";
+    finalDataset.SetTitle(sla > 0 ? finalTitle + " (SLA: " + std::to_string(int(std::round(sla * 100))) + " por ciento de usuarios)"
+                                  : finalTitle);
     finalDataset.SetExtra("lw 2 pt 7 ps 1.5");
 
     int validResultsCount = 0;
@@ -387,7 +961,17 @@ main(int argc, char* argv[])
                       << " Mbps"
                       << " (Latencia: " << std::fixed << std::setprecision(2)
                       << result.second.delayMean << " +- " << result.second.delayMarginOfError
-                      << " ms)" << std::endl;
+                      << " ms";
+            if (result.second.usersOkMean >= 0)
+            {
+                std::cout << ", usuarios que cumplen: " << result.second.usersOkMean * 100 << " +- "
+                          << result.second.usersOkMarginOfError * 100 << " %";
+            }
+            if (result.second.edgeHitMean >= 0)
+            {
+                std::cout << ", aciertos de las cachés de borde: " << result.second.edgeHitMean * 100 << " %";
+            }
+            std::cout << ")" << std::defaultfloat << std::setprecision(6) << std::endl;
         }
         else
         {
@@ -407,7 +991,7 @@ main(int argc, char* argv[])
         plotFinal.SetExtra("set grid; set key top left; set xtics 50;");
         plotFinal.AddDataset(finalDataset);
 
-        std::string pltPath = std::string(dir) + "/final.plt";
+        std::string pltPath = dir + "/final.plt";
         std::ofstream plotFinalFile(pltPath);
         plotFinal.GenerateOutput(plotFinalFile);
         plotFinalFile.close();
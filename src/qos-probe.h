@@ -0,0 +1,427 @@
+#ifndef QOS_PROBE_H
+#define QOS_PROBE_H
+
+#include "user-qos.h"
+
+#include "ns3/abort.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/ipv4-l3-protocol.h"
+#include "ns3/node-container.h"
+#include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/simulator.h"
+#include "ns3/tag.h"
+#include "ns3/tcp-header.h"
+
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_set>
+#include <vector>
+
+#ifdef NS3_MPI
+#include <mpi.h>
+#endif
+
+namespace ns3
+{
+
+// Marca de tiempo que el extremo emisor añade a cada paquete IP del servidor o de un usuario
+class QosProbeTag : public Tag
+{
+  public:
+    static TypeId GetTypeId()
+    {
+        static TypeId tid = TypeId("ns3::QosProbeTag").SetParent<Tag>().AddConstructor<QosProbeTag>();
+        return tid;
+    }
+
+    TypeId GetInstanceTypeId() const override
+    {
+        return GetTypeId();
+    }
+
+    uint32_t GetSerializedSize() const override
+    {
+        return 8;
+    }
+
+    void Serialize(TagBuffer i) const override
+    {
+        i.WriteU64(m_txTs);
+    }
+
+    void Deserialize(TagBuffer i) override
+    {
+        m_txTs = i.ReadU64();
+    }
+
+    void Print(std::ostream& os) const override
+    {
+        os << "txTs=" << m_txTs;
+    }
+
+    int64_t m_txTs = 0; // Instante de envío en pasos de tiempo del simulador
+};
+
+NS_OBJECT_ENSURE_REGISTERED(QosProbeTag);
+
+/**
+ * Sonda ligera de QoS por flujo, alternativa a FlowMonitorHelper::InstallAll().
+ *
+ * Solo se engancha a las trazas SendOutgoing/LocalDeliver de la capa IPv4 del servidor y
+ * de los usuarios (no de los routers). El emisor marca cada paquete con su instante de
+ * envío y el receptor acumula retardo, jitter y paquetes recibidos en vectores planos
+ * reservados de antemano, sin tablas hash ni registros por paquete. Cada usuario tiene
+ * dos flujos (servidor -> usuario y usuario -> servidor, los ACK de TCP), igual que los
+ * que clasifica FlowMonitor, de modo que las métricas finales son las mismas columnas.
+ * Las pérdidas se obtienen como enviados - recibidos al final de la simulación. Los flujos
+ * de bajada llevan además histogramas de retardo y jitter de memoria fija (LatencySketch)
+ * para la distribución de la QoS por usuario.
+ *
+ * Con nodos de abonado agregados (access = aggregated en topology.h) un nodo aloja varios
+ * usuarios, uno por puerto; entonces el usuario se obtiene de la dirección y del puerto TCP.
+ *
+ * Con cachés de borde (edge-cache.h) algunas sesiones las sirve el router de su región: esos
+ * routers se registran con AddEdgeServer() y cuentan como el servidor para sus propios envíos
+ * y recepciones (no para los paquetes que solo reenvían).
+ */
+class QosProbe
+{
+  public:
+    QosProbe(Ptr<Node> server, Ipv4Address serverAddress, uint32_t numUsers)
+        : m_server(server),
+          m_serverAddress(serverAddress),
+          m_tx(2 * numUsers, 0),
+          m_rx(2 * numUsers, 0),
+          m_delaySum(2 * numUsers, 0),
+          m_jitterSum(2 * numUsers, 0),
+          m_lastDelay(2 * numUsers, -1),
+          m_delaySketch(numUsers),
+          m_jitterSketch(numUsers)
+    {
+        Ptr<Ipv4L3Protocol> ipv4 = server->GetObject<Ipv4L3Protocol>();
+        ipv4->TraceConnectWithoutContext("SendOutgoing", MakeBoundCallback(&QosProbe::ServerTx, this));
+        ipv4->TraceConnectWithoutContext("LocalDeliver", MakeBoundCallback(&QosProbe::ServerRx, this));
+    }
+
+    // Registra los usuarios de una región, con direcciones consecutivas a partir de 'first'
+    void AddUsers(const NodeContainer& users, Ipv4Address first)
+    {
+        AddUsers(users, first, 1, 1, 0, users.GetN());
+    }
+
+    // Registra 'numUsers' usuarios repartidos en 'nodes': el nodo k tiene la dirección
+    // first + k * stride y sus usuarios usan los puertos basePort .. basePort + sessionsPerNode - 1
+    void AddUsers(const NodeContainer& nodes,
+                  Ipv4Address first,
+                  uint32_t stride,
+                  uint32_t sessionsPerNode,
+                  uint16_t basePort,
+                  uint32_t numUsers)
+    {
+        uint32_t firstUser = m_nextUser;
+        NS_ABORT_MSG_IF(2 * (firstUser + numUsers) > m_tx.size(), "QosProbe: más usuarios de los reservados");
+        uint32_t range = m_ranges.size();
+        m_ranges.push_back({first.Get(), nodes.GetN(), firstUser, stride, sessionsPerNode, basePort, numUsers});
+        for (uint32_t k = 0; k < nodes.GetN(); ++k)
+        {
+            Ptr<Ipv4L3Protocol> ipv4 = nodes.Get(k)->GetObject<Ipv4L3Protocol>();
+            ipv4->TraceConnectWithoutContext("SendOutgoing", MakeBoundCallback(&QosProbe::UserTx, this, range, k));
+            ipv4->TraceConnectWithoutContext("LocalDeliver", MakeBoundCallback(&QosProbe::UserRx, this, range, k));
+        }
+        m_nextUser += numUsers;
+    }
+
+    // Registra un nodo que también sirve sesiones (caché de borde): sus paquetes cuentan
+    // como los del servidor y sus direcciones se aceptan en los usuarios
+    void AddEdgeServer(Ptr<Node> node)
+    {
+        Ptr<Ipv4L3Protocol> ipv4 = node->GetObject<Ipv4L3Protocol>();
+        ipv4->TraceConnectWithoutContext("SendOutgoing", MakeBoundCallback(&QosProbe::ServerTx, this));
+        ipv4->TraceConnectWithoutContext("LocalDeliver", MakeBoundCallback(&QosProbe::ServerRx, this));
+        for (uint32_t i = 0; i < ipv4->GetNInterfaces(); ++i)
+        {
+            for (uint32_t a = 0; a < ipv4->GetNAddresses(i); ++a)
+            {
+                m_edgeAddresses.insert(ipv4->GetAddress(i, a).GetLocal().Get());
+            }
+        }
+    }
+
+    // Calcula las mismas métricas que el bucle sobre FlowMonitor::GetFlowStats()
+    void Compute(double& lossRatio, double& avgDelayMs, double& avgJitterMs) const
+    {
+        double totalTx = 0, totalLost = 0;
+        double delaySum = 0, jitterSum = 0;
+        uint32_t delayCount = 0, jitterCount = 0;
+        for (uint32_t f = 0; f < m_tx.size(); ++f)
+        {
+            if (m_tx[f] > 10)
+            {
+                totalTx += m_tx[f];
+                totalLost += m_tx[f] > m_rx[f] ? m_tx[f] - m_rx[f] : 0;
+                if (m_rx[f] > 0)
+                {
+                    delaySum += TimeStep(m_delaySum[f]).GetSeconds() / m_rx[f] * 1000;
+                    ++delayCount;
+                }
+                if (m_rx[f] > 1)
+                {
+                    jitterSum += TimeStep(m_jitterSum[f]).GetSeconds() / (m_rx[f] - 1) * 1000;
+                    ++jitterCount;
+                }
+            }
+        }
+        lossRatio = totalTx > 0 ? totalLost / totalTx * 100 : 0;
+        avgDelayMs = delayCount > 0 ? delaySum / delayCount : 0;
+        avgJitterMs = jitterCount > 0 ? jitterSum / jitterCount : 0;
+    }
+
+    // Contadores acumulados del flujo f, que se pueden leer en mitad de la simulación
+    // (OutputAnalyzer de output-analysis.h)
+    uint32_t FlowCount() const
+    {
+        return m_tx.size();
+    }
+
+    void FlowTotals(uint32_t f, uint64_t& tx, uint64_t& rx, double& delaySumS, double& jitterSumS) const
+    {
+        tx = m_tx[f];
+        rx = m_rx[f];
+        delaySumS = TimeStep(m_delaySum[f]).GetSeconds();
+        jitterSumS = TimeStep(m_jitterSum[f]).GetSeconds();
+    }
+
+    // Distribución de la QoS entre los usuarios (flujos de bajada), con las medias por usuario
+    // sin los contadores de 'before' (índices de FlowTotals; vacío = desde el principio)
+    UserQosSummary UserQos(const std::vector<FlowCounters>& before = {}) const
+    {
+        static const FlowCounters zero;
+        UserQosSummary summary;
+        for (uint32_t u = 0; u < m_delaySketch.size(); ++u)
+        {
+            uint32_t f = 2 * u;
+            FlowCounters now;
+            FlowTotals(f, now.txPackets, now.rxPackets, now.delaySumS, now.jitterSumS);
+            summary.AddUser(now, f < before.size() ? before[f] : zero, m_delaySketch[u], m_jitterSketch[u]);
+        }
+        return summary;
+    }
+
+    // Histogramas de los flujos de bajada de todos los usuarios
+    void Sketches(LatencySketch& delay, LatencySketch& jitter) const
+    {
+        delay = LatencySketch();
+        jitter = LatencySketch();
+        for (uint32_t u = 0; u < m_delaySketch.size(); ++u)
+        {
+            delay.Merge(m_delaySketch[u]);
+            jitter.Merge(m_jitterSketch[u]);
+        }
+    }
+
+#ifdef NS3_MPI
+    // Simulación distribuida: cada proceso solo ve los envíos y recepciones de sus nodos, así
+    // que los contadores se suman en el proceso 0 antes de llamar a Compute() en él
+    void ReduceToRoot(MPI_Comm comm)
+    {
+        int rank;
+        MPI_Comm_rank(comm, &rank);
+        auto reduce = [&](auto& counters, MPI_Datatype type) {
+            if (rank == 0)
+            {
+                MPI_Reduce(MPI_IN_PLACE, counters.data(), counters.size(), type, MPI_SUM, 0, comm);
+            }
+            else
+            {
+                MPI_Reduce(counters.data(), nullptr, counters.size(), type, MPI_SUM, 0, comm);
+            }
+        };
+        reduce(m_tx, MPI_UINT32_T);
+        reduce(m_rx, MPI_UINT32_T);
+        reduce(m_delaySum, MPI_INT64_T);
+        reduce(m_jitterSum, MPI_INT64_T);
+        for (auto* sketches : {&m_delaySketch, &m_jitterSketch})
+        {
+            for (auto& sketch : *sketches)
+            {
+                if (rank == 0)
+                {
+                    MPI_Reduce(MPI_IN_PLACE, sketch.Data(), LatencySketch::BINS, MPI_UINT32_T, MPI_SUM, 0, comm);
+                    sketch.Recount();
+                }
+                else
+                {
+                    MPI_Reduce(sketch.Data(), nullptr, LatencySketch::BINS, MPI_UINT32_T, MPI_SUM, 0, comm);
+                }
+            }
+        }
+    }
+#endif
+
+  private:
+    struct AddressRange
+    {
+        uint32_t first;
+        uint32_t count; // Nodos
+        uint32_t firstUser;
+        uint32_t stride;
+        uint32_t sessionsPerNode;
+        uint16_t basePort;
+        uint32_t numUsers;
+    };
+
+    // Índice de usuario del nodo 'node' del rango y del puerto dado, o -1 si no corresponde a ninguno
+    int64_t UserOfNode(const AddressRange& r, uint32_t node, uint16_t port) const
+    {
+        uint32_t session = 0;
+        if (r.sessionsPerNode > 1)
+        {
+            session = static_cast<uint16_t>(port - r.basePort);
+            if (session >= r.sessionsPerNode)
+            {
+                return -1;
+            }
+        }
+        uint32_t user = node * r.sessionsPerNode + session;
+        return user < r.numUsers ? r.firstUser + user : -1;
+    }
+
+    // Índice de usuario de una dirección IP (y puerto), o -1 si no pertenece a ningún usuario
+    int64_t UserOf(Ipv4Address address, Ptr<const Packet> packet, bool destinationPort) const
+    {
+        uint32_t a = address.Get();
+        for (const auto& r : m_ranges)
+        {
+            uint32_t offset = a - r.first;
+            if (a >= r.first && offset % r.stride == 0 && offset / r.stride < r.count)
+            {
+                return UserOfNode(r, offset / r.stride, r.sessionsPerNode > 1 ? Port(packet, destinationPort) : 0);
+            }
+        }
+        return -1;
+    }
+
+    // El servidor o una caché de borde
+    bool IsSource(Ipv4Address address) const
+    {
+        return address == m_serverAddress || (!m_edgeAddresses.empty() && m_edgeAddresses.count(address.Get()) > 0);
+    }
+
+    // Puerto TCP de origen o destino del paquete (sin cabecera IP)
+    static uint16_t Port(Ptr<const Packet> packet, bool destination)
+    {
+        TcpHeader tcp;
+        packet->PeekHeader(tcp);
+        return destination ? tcp.GetDestinationPort() : tcp.GetSourcePort();
+    }
+
+    void Stamp(uint32_t flow, Ptr<const Packet> packet)
+    {
+        QosProbeTag tag;
+        tag.m_txTs = Simulator::Now().GetTimeStep();
+        packet->AddPacketTag(tag);
+        ++m_tx[flow];
+    }
+
+    void Record(uint32_t flow, Ptr<const Packet> packet)
+    {
+        QosProbeTag tag;
+        if (!ConstCast<Packet>(packet)->RemovePacketTag(tag))
+        {
+            return;
+        }
+        int64_t delay = Simulator::Now().GetTimeStep() - tag.m_txTs;
+        ++m_rx[flow];
+        m_delaySum[flow] += delay;
+        bool downlink = flow % 2 == 0;
+        if (downlink)
+        {
+            m_delaySketch[flow / 2].Add(TimeStep(delay).GetMicroSeconds());
+        }
+        if (m_lastDelay[flow] >= 0)
+        {
+            m_jitterSum[flow] += std::llabs(delay - m_lastDelay[flow]);
+            if (downlink)
+            {
+                m_jitterSketch[flow / 2].Add(TimeStep(std::llabs(delay - m_lastDelay[flow])).GetMicroSeconds());
+            }
+        }
+        m_lastDelay[flow] = delay;
+    }
+
+    static void ServerTx(QosProbe* probe, const Ipv4Header& header, Ptr<const Packet> packet, uint32_t)
+    {
+        int64_t user = probe->UserOf(header.GetDestination(), packet, true);
+        if (user >= 0)
+        {
+            probe->Stamp(2 * user, packet);
+        }
+    }
+
+    static void ServerRx(QosProbe* probe, const Ipv4Header& header, Ptr<const Packet> packet, uint32_t)
+    {
+        int64_t user = probe->UserOf(header.GetSource(), packet, false);
+        if (user >= 0)
+        {
+            probe->Record(2 * user + 1, packet);
+        }
+    }
+
+    static void UserTx(QosProbe* probe,
+                       uint32_t range,
+                       uint32_t node,
+                       const Ipv4Header& header,
+                       Ptr<const Packet> packet,
+                       uint32_t)
+    {
+        if (probe->IsSource(header.GetDestination()))
+        {
+            const AddressRange& r = probe->m_ranges[range];
+            int64_t user = probe->UserOfNode(r, node, r.sessionsPerNode > 1 ? Port(packet, false) : 0);
+            if (user >= 0)
+            {
+                probe->Stamp(2 * user + 1, packet);
+            }
+        }
+    }
+
+    static void UserRx(QosProbe* probe,
+                       uint32_t range,
+                       uint32_t node,
+                       const Ipv4Header& header,
+                       Ptr<const Packet> packet,
+                       uint32_t)
+    {
+        if (probe->IsSource(header.GetSource()))
+        {
+            const AddressRange& r = probe->m_ranges[range];
+            int64_t user = probe->UserOfNode(r, node, r.sessionsPerNode > 1 ? Port(packet, true) : 0);
+            if (user >= 0)
+            {
+                probe->Record(2 * user, packet);
+            }
+        }
+    }
+
+    Ptr<Node> m_server;
+    Ipv4Address m_serverAddress;
+    std::unordered_set<uint32_t> m_edgeAddresses; // Direcciones de los nodos de AddEdgeServer()
+    std::vector<AddressRange> m_ranges;
+    uint32_t m_nextUser = 0;
+
+    // Contadores por flujo: 2 * usuario (bajada) y 2 * usuario + 1 (subida)
+    std::vector<uint32_t> m_tx;
+    std::vector<uint32_t> m_rx;
+    std::vector<int64_t> m_delaySum;  // Pasos de tiempo
+    std::vector<int64_t> m_jitterSum; // Pasos de tiempo
+    std::vector<int64_t> m_lastDelay; // -1 hasta el primer paquete recibido
+    std::vector<LatencySketch> m_delaySketch;  // Por usuario, flujo de bajada
+    std::vector<LatencySketch> m_jitterSketch; // Por usuario, flujo de bajada
+};
+
+} // namespace ns3
+
+#endif // QOS_PROBE_H
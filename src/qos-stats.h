@@ -0,0 +1,110 @@
+#ifndef QOS_STATS_H
+#define QOS_STATS_H
+
+// Definiciones compartidas por onoffRouting.cc y plot-results.cc.
+
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+// --- UMBRALES DE CALIDAD DE SERVICIO (QoS) ---
+const double MAX_DELAY_MS = 20.0;
+const double MAX_JITTER_MS = 8.0;
+const double MAX_LOSS_PERCENT = 0.5;
+
+// Indica si un punto (medias de sus réplicas) cumple los tres requisitos de QoS
+inline bool
+MeetsQos(double delayMs, double jitterMs, double lossPercent)
+{
+    return delayMs <= MAX_DELAY_MS && jitterMs <= MAX_JITTER_MS && lossPercent <= MAX_LOSS_PERCENT;
+}
+
+// --- ESTADÍSTICA DE LAS RÉPLICAS ---
+
+// Cuantil 0.975 de la t de Student con 'df' grados de libertad (IC bilateral del 95%)
+inline double
+StudentT975(uint32_t df)
+{
+    static const double table[] = {0.0,    12.7062, 4.3027, 3.1824, 2.7764, 2.5706, 2.4469,
+                                   2.3646, 2.3060,  2.2622, 2.2281, 2.2010, 2.1788, 2.1604,
+                                   2.1448, 2.1314,  2.1199, 2.1098, 2.1009, 2.0930, 2.0860,
+                                   2.0796, 2.0739,  2.0687, 2.0639, 2.0595, 2.0555, 2.0518,
+                                   2.0484, 2.0452,  2.0423};
+    if (df <= 30)
+    {
+        return table[df];
+    }
+    // Desarrollo de Cornish-Fisher alrededor de la normal (error < 1e-4 para df > 30)
+    const double z = 1.959964;
+    double n = df;
+    return z + (std::pow(z, 3) + z) / (4 * n) +
+           (5 * std::pow(z, 5) + 16 * std::pow(z, 3) + 3 * z) / (96 * n * n) +
+           (3 * std::pow(z, 7) + 19 * std::pow(z, 5) + 17 * std::pow(z, 3) - 15 * z) / (384 * n * n * n);
+}
+
+// Función para calcular la media
+inline double
+CalculateMean(const std::vector<double>& samples)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    double sum = std::accumulate(samples.begin(), samples.end(), 0.0);
+    return sum / samples.size();
+}
+
+// Funciones para calcular la desviación estándar y el margen de error del 95%
+inline double
+CalculateStdDev(const std::vector<double>& samples, double mean)
+{
+    if (samples.size() < 2)
+    {
+        return 0.0;
+    }
+    double sq_sum = 0.0;
+    for (const auto& s : samples)
+    {
+        sq_sum += std::pow(s - mean, 2);
+    }
+    return std::sqrt(sq_sum / (samples.size() - 1));
+}
+
+// Semiancho del IC del 95% usando el cuantil t del tamaño de muestra real
+inline double
+CalculateMarginOfError(double stdDev, int sampleSize)
+{
+    if (sampleSize < 2)
+        return 0.0;
+    return StudentT975(sampleSize - 1) * stdDev / std::sqrt(sampleSize);
+}
+
+// Acumulador de una pasada (algoritmo de Welford): media y varianza sin guardar las muestras.
+// Es un POD, así que puede guardarse tal cual en un fichero binario.
+struct RunningStats
+{
+    uint64_t n = 0;
+    double mean = 0.0;
+    double m2 = 0.0; // Suma de cuadrados de las desviaciones respecto a la media
+
+    void Add(double x)
+    {
+        ++n;
+        double delta = x - mean;
+        mean += delta / n;
+        m2 += delta * (x - mean);
+    }
+
+    double StdDev() const
+    {
+        return n < 2 ? 0.0 : std::sqrt(m2 / (n - 1));
+    }
+
+    double MarginOfError() const
+    {
+        return CalculateMarginOfError(StdDev(), n);
+    }
+};
+
+#endif // QOS_STATS_H
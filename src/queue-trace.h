@@ -0,0 +1,175 @@
+#ifndef QUEUE_TRACE_H
+#define QUEUE_TRACE_H
+
+#include "ns3/csma-net-device.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/packet.h"
+#include "ns3/queue.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// --- FORMATO BINARIO DE LA SERIE TEMPORAL DE LA COLA ---
+// Cabecera seguida de numSamples registros QueueSample en orden cronológico.
+// Lo escribe onoffRouting (--queueTrace) y lo lee plot-results (--queueTrace).
+struct QueueTraceHeader
+{
+    char magic[4];     // "QTS1"
+    uint32_t version;  // 1
+    double intervalS;  // Intervalo de muestreo
+    uint32_t numSamples;
+    uint32_t users;
+    double bitrateMbps;
+    uint32_t seed;
+    uint32_t run;      // Ejecución del generador (0 en las series anteriores)
+};
+
+struct QueueSample
+{
+    double timeS;
+    uint32_t packets;    // Paquetes en la cola del dispositivo al muestrear
+    uint32_t bytes;      // Bytes en la cola del dispositivo al muestrear
+    float sojournMeanMs; // Tiempo medio en cola de los paquetes que salieron en el intervalo
+    float sojournMaxMs;  // Tiempo máximo en cola en el intervalo
+    uint32_t drops;      // Paquetes descartados por la cola en el intervalo
+    float utilisation;   // Fracción del enlace ocupada transmitiendo en el intervalo
+};
+
+static_assert(sizeof(QueueTraceHeader) == 40, "QueueTraceHeader debe ocupar 40 bytes");
+static_assert(sizeof(QueueSample) == 32, "QueueSample debe ocupar 32 bytes");
+
+// Lee un fichero de serie temporal. Devuelve false si no existe o no tiene el formato esperado.
+inline bool
+ReadQueueTrace(const std::string& fileName, QueueTraceHeader& header, std::vector<QueueSample>& samples)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, "QTS1", 4) != 0 || header.version != 1)
+    {
+        return false;
+    }
+    samples.resize(header.numSamples);
+    return static_cast<bool>(
+        in.read(reinterpret_cast<char*>(samples.data()), samples.size() * sizeof(QueueSample)));
+}
+
+namespace ns3
+{
+
+/**
+ * Muestreador de la cola de transmisión del enlace cuello de botella (router1 -> router2).
+ *
+ * Se engancha a las trazas Enqueue/Dequeue/Drop de la cola del CsmaNetDevice y a PhyTxEnd
+ * del dispositivo, y cada 'interval' guarda una QueueSample en un buffer circular reservado
+ * al crear el objeto. Los instantes de encolado se guardan en otro anillo del tamaño máximo
+ * de la cola, de modo que el tiempo de permanencia se obtiene sin reservar memoria durante
+ * la simulación. Al final, Write() vuelca las muestras en el formato binario de arriba.
+ */
+class BottleneckQueueMonitor
+{
+  public:
+    BottleneckQueueMonitor(Ptr<CsmaNetDevice> device, DataRate rate, Time interval, Time horizon)
+        : m_queue(device->GetQueue()),
+          m_rateBps(rate.GetBitRate()),
+          m_interval(interval),
+          m_samples(static_cast<size_t>(horizon.GetSeconds() / interval.GetSeconds()) + 1),
+          m_enqueueTs(std::max<uint32_t>(1, m_queue->GetMaxSize().GetValue()))
+    {
+        m_queue->TraceConnectWithoutContext("Enqueue", MakeCallback(&BottleneckQueueMonitor::Enqueue, this));
+        m_queue->TraceConnectWithoutContext("Dequeue", MakeCallback(&BottleneckQueueMonitor::Dequeue, this));
+        m_queue->TraceConnectWithoutContext("Drop", MakeCallback(&BottleneckQueueMonitor::Drop, this));
+        device->TraceConnectWithoutContext("PhyTxEnd", MakeCallback(&BottleneckQueueMonitor::TxEnd, this));
+        m_event = Simulator::Schedule(m_interval, &BottleneckQueueMonitor::Sample, this);
+    }
+
+    void Write(const std::string& fileName, uint32_t users, double bitrateMbps, uint32_t seed, uint32_t run) const
+    {
+        size_t n = std::min(m_count, m_samples.size());
+        QueueTraceHeader header{{'Q', 'T', 'S', '1'}, 1, m_interval.GetSeconds(), static_cast<uint32_t>(n),
+                                users, bitrateMbps, seed, run};
+        std::ofstream out(fileName, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        // Si el anillo ha dado la vuelta, la muestra más antigua está en m_count % capacidad
+        size_t first = m_count > m_samples.size() ? m_count % m_samples.size() : 0;
+        for (size_t k = 0; k < n; ++k)
+        {
+            out.write(reinterpret_cast<const char*>(&m_samples[(first + k) % m_samples.size()]),
+                      sizeof(QueueSample));
+        }
+    }
+
+  private:
+    void Enqueue(Ptr<const Packet>)
+    {
+        m_enqueueTs[m_tail] = Simulator::Now().GetTimeStep();
+        m_tail = (m_tail + 1) % m_enqueueTs.size();
+    }
+
+    void Dequeue(Ptr<const Packet>)
+    {
+        double sojournMs = TimeStep(Simulator::Now().GetTimeStep() - m_enqueueTs[m_head]).GetSeconds() * 1000;
+        m_head = (m_head + 1) % m_enqueueTs.size();
+        m_sojournSum += sojournMs;
+        m_sojournMax = std::max(m_sojournMax, sojournMs);
+        ++m_dequeued;
+    }
+
+    void Drop(Ptr<const Packet>)
+    {
+        ++m_drops;
+    }
+
+    void TxEnd(Ptr<const Packet> packet)
+    {
+        m_txBits += static_cast<uint64_t>(packet->GetSize()) * 8;
+    }
+
+    void Sample()
+    {
+        QueueSample& s = m_samples[m_count % m_samples.size()];
+        s.timeS = Simulator::Now().GetSeconds();
+        s.packets = m_queue->GetNPackets();
+        s.bytes = m_queue->GetNBytes();
+        s.sojournMeanMs = m_dequeued > 0 ? m_sojournSum / m_dequeued : 0;
+        s.sojournMaxMs = m_sojournMax;
+        s.drops = m_drops;
+        s.utilisation = std::min(1.0, m_txBits / (m_rateBps * m_interval.GetSeconds()));
+        ++m_count;
+
+        m_sojournSum = 0;
+        m_sojournMax = 0;
+        m_dequeued = 0;
+        m_drops = 0;
+        m_txBits = 0;
+        m_event = Simulator::Schedule(m_interval, &BottleneckQueueMonitor::Sample, this);
+    }
+
+    Ptr<Queue<Packet>> m_queue;
+    double m_rateBps;
+    Time m_interval;
+    EventId m_event;
+
+    std::vector<QueueSample> m_samples; // Buffer circular de muestras
+    size_t m_count = 0;                 // Muestras tomadas (puede superar la capacidad)
+
+    std::vector<int64_t> m_enqueueTs; // Anillo FIFO con el instante de encolado de cada paquete
+    size_t m_head = 0;
+    size_t m_tail = 0;
+
+    // Acumuladores del intervalo en curso
+    double m_sojournSum = 0;
+    double m_sojournMax = 0;
+    uint32_t m_dequeued = 0;
+    uint32_t m_drops = 0;
+    uint64_t m_txBits = 0;
+};
+
+} // namespace ns3
+
+#endif // QUEUE_TRACE_H
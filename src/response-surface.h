@@ -0,0 +1,470 @@
+#ifndef RESPONSE_SURFACE_H
+#define RESPONSE_SURFACE_H
+
+// Modelo sustituto de las métricas de QoS en función de (usuarios, bitrate), ajustado a las
+// medias de las celdas ya simuladas. Lo usa plot-results.cc (--predict y --suggest).
+
+#include "qos-stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Umbrales de QoS de una consulta; por defecto los de qos-stats.h
+struct QosThresholds
+{
+    double delayMs = MAX_DELAY_MS;
+    double jitterMs = MAX_JITTER_MS;
+    double lossPercent = MAX_LOSS_PERCENT;
+};
+
+// Medias de una celda (usuarios, bitrate) y varianza de cada media (desviación² / réplicas)
+struct SurrogateCell
+{
+    double users;
+    double bitrate;
+    double delayMean, delayVariance;
+    double jitterMean, jitterVariance;
+    double lossMean, lossVariance;
+};
+
+/**
+ * Proceso gaussiano (kriging) con núcleo Matérn 5/2 anisótropo sobre (usuarios, capacidad
+ * por usuario).
+ *
+ * La métrica se modela como log(valor + offset): el retardo y el jitter caen varios órdenes
+ * de magnitud al pasar el punto de saturación, y en escala logarítmica la superficie es mucho
+ * más suave. Cada celda aporta su propio ruido (la varianza de su media, llevada a la escala
+ * logarítmica por el método delta), de modo que las celdas con pocas réplicas pesan menos.
+ *
+ * Las longitudes de correlación, la varianza de la señal y un ruido común que absorbe lo que
+ * el núcleo no explica (el salto del punto de saturación) se eligen maximizando la
+ * verosimilitud marginal sobre una rejilla, sin dependencias externas.
+ */
+class GaussianSurface
+{
+  public:
+    void Fit(const std::vector<double>& users,
+             const std::vector<double>& bitrates,
+             const std::vector<double>& means,
+             const std::vector<double>& variances,
+             double offset)
+    {
+        m_offset = offset;
+        m_userMin = *std::min_element(users.begin(), users.end());
+        m_userRange = std::max(*std::max_element(users.begin(), users.end()) - m_userMin, 1.0);
+        std::vector<double> capacity(users.size());
+        for (size_t i = 0; i < users.size(); ++i)
+        {
+            capacity[i] = Capacity(users[i], bitrates[i]);
+        }
+        m_capacityMin = *std::min_element(capacity.begin(), capacity.end());
+        m_capacityRange = std::max(*std::max_element(capacity.begin(), capacity.end()) - m_capacityMin, 1e-3);
+
+        std::vector<double> y(means.size());
+        for (size_t i = 0; i < means.size(); ++i)
+        {
+            y[i] = Transform(means[i]);
+        }
+        m_yMean = CalculateMean(y);
+        m_yScale = std::max(CalculateStdDev(y, m_yMean), 1e-9);
+
+        m_x.clear();
+        m_y.clear();
+        m_noise.clear();
+        for (size_t i = 0; i < means.size(); ++i)
+        {
+            double slope = 1.0 / (std::max(means[i], 0.0) + m_offset);
+            m_x.push_back(Normalize(users[i], bitrates[i]));
+            m_y.push_back((y[i] - m_yMean) / m_yScale);
+            m_noise.push_back(variances[i] * slope * slope / (m_yScale * m_yScale));
+        }
+
+        static const double lengths[] = {0.03, 0.05, 0.1, 0.2, 0.35, 0.6, 1.0, 1.6};
+        static const double signals[] = {0.5, 1.0, 2.0};
+        static const double nuggets[] = {1e-4, 1e-3, 1e-2, 5e-2};
+        double best = -std::numeric_limits<double>::infinity();
+        Hyper chosen = m_hyper;
+        for (double lu : lengths)
+        {
+            for (double lc : lengths)
+            {
+                for (double s2 : signals)
+                {
+                    for (double nugget : nuggets)
+                    {
+                        m_hyper = {lu, lc, s2, nugget};
+                        double lml;
+                        if (Factorize(&lml) && lml > best)
+                        {
+                            best = lml;
+                            chosen = m_hyper;
+                        }
+                    }
+                }
+            }
+        }
+        m_hyper = chosen;
+        Factorize(nullptr);
+    }
+
+    // Media y desviación típica de log(métrica + offset) en (users, bitrate). 'latentSd', si
+    // no es nulo, recibe la parte de la desviación que bajaría simulando más puntos: la total
+    // incluye además el ruido común, que es error del propio modelo y no desaparece.
+    void Predict(double users, double bitrate, double& mean, double& sd, double* latentSd = nullptr) const
+    {
+        Input x = Normalize(users, bitrate);
+        size_t n = m_x.size();
+        std::vector<double> k(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            k[i] = Kernel(x, m_x[i]);
+        }
+        double mu = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            mu += k[i] * m_alpha[i];
+        }
+        // v = L⁻¹ k, varianza = s² - v·v
+        double variance = m_hyper.signal;
+        for (size_t i = 0; i < n; ++i)
+        {
+            double sum = k[i];
+            for (size_t j = 0; j < i; ++j)
+            {
+                sum -= m_chol[i * n + j] * k[j];
+            }
+            k[i] = sum / m_chol[i * n + i];
+            variance -= k[i] * k[i];
+        }
+        variance = std::max(variance, 1e-12);
+        mean = m_yMean + m_yScale * mu;
+        sd = m_yScale * std::sqrt(variance + m_hyper.nugget);
+        if (latentSd)
+        {
+            *latentSd = m_yScale * std::sqrt(variance);
+        }
+    }
+
+    double Transform(double value) const
+    {
+        return std::log(std::max(value, 0.0) + m_offset);
+    }
+
+    double Untransform(double value) const
+    {
+        return std::max(std::exp(value) - m_offset, 0.0);
+    }
+
+    // Añade una observación ficticia igual a la predicción en (users, bitrate), con el ruido
+    // típico de las celdas reales. La media apenas cambia, pero la incertidumbre alrededor
+    // cae como si se hubiera simulado ese punto ("kriging believer"); así las sugerencias
+    // sucesivas no se amontonan en el mismo sitio.
+    void Condition(double users, double bitrate)
+    {
+        double mean, sd;
+        Predict(users, bitrate, mean, sd);
+        std::vector<double> noise = m_noise;
+        std::nth_element(noise.begin(), noise.begin() + noise.size() / 2, noise.end());
+        m_x.push_back(Normalize(users, bitrate));
+        m_y.push_back((mean - m_yMean) / m_yScale);
+        m_noise.push_back(noise[noise.size() / 2]);
+        Factorize(nullptr);
+    }
+
+    // Longitudes de correlación elegidas: en usuarios, y en log(Mbps por usuario)
+    double UserLength() const
+    {
+        return m_hyper.userLength * m_userRange;
+    }
+
+    double CapacityLength() const
+    {
+        return m_hyper.capacityLength * m_capacityRange;
+    }
+
+  private:
+    struct Input
+    {
+        double users;
+        double capacity;
+    };
+
+    struct Hyper
+    {
+        double userLength = 0.3;
+        double capacityLength = 0.3;
+        double signal = 1.0;
+        double nugget = 1e-3;
+    };
+
+    // La saturación depende sobre todo de la capacidad por usuario, así que la segunda
+    // coordenada es log(bitrate / usuarios) en lugar del bitrate: el salto de la saturación
+    // queda casi a la misma altura para todos los números de usuarios.
+    static double Capacity(double users, double bitrate)
+    {
+        return std::log(bitrate / std::max(users, 1.0));
+    }
+
+    Input Normalize(double users, double bitrate) const
+    {
+        return {(users - m_userMin) / m_userRange, (Capacity(users, bitrate) - m_capacityMin) / m_capacityRange};
+    }
+
+    double Kernel(const Input& a, const Input& b) const
+    {
+        double du = (a.users - b.users) / m_hyper.userLength;
+        double dc = (a.capacity - b.capacity) / m_hyper.capacityLength;
+        double r = std::sqrt(5.0 * (du * du + dc * dc));
+        return m_hyper.signal * (1 + r + r * r / 3) * std::exp(-r);
+    }
+
+    // Cholesky de K + diag(ruido) y alpha = K⁻¹ y. Si 'lml' no es nulo devuelve en él la
+    // log-verosimilitud marginal (sin la constante). Falla si la matriz no es definida positiva.
+    bool Factorize(double* lml)
+    {
+        size_t n = m_x.size();
+        m_chol.assign(n * n, 0.0);
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t j = 0; j <= i; ++j)
+            {
+                double sum = Kernel(m_x[i], m_x[j]);
+                if (i == j)
+                {
+                    sum += m_noise[i] + m_hyper.nugget;
+                }
+                for (size_t k = 0; k < j; ++k)
+                {
+                    sum -= m_chol[i * n + k] * m_chol[j * n + k];
+                }
+                if (i == j)
+                {
+                    if (sum <= 0)
+                    {
+                        return false;
+                    }
+                    m_chol[i * n + i] = std::sqrt(sum);
+                }
+                else
+                {
+                    m_chol[i * n + j] = sum / m_chol[j * n + j];
+                }
+            }
+        }
+        // L z = y, Lᵀ alpha = z
+        m_alpha = m_y;
+        for (size_t i = 0; i < n; ++i)
+        {
+            for (size_t k = 0; k < i; ++k)
+            {
+                m_alpha[i] -= m_chol[i * n + k] * m_alpha[k];
+            }
+            m_alpha[i] /= m_chol[i * n + i];
+        }
+        double fit = 0, logDet = 0;
+        for (size_t i = 0; i < n; ++i)
+        {
+            fit += m_alpha[i] * m_alpha[i];
+            logDet += std::log(m_chol[i * n + i]);
+        }
+        for (size_t i = n; i-- > 0;)
+        {
+            for (size_t k = i + 1; k < n; ++k)
+            {
+                m_alpha[i] -= m_chol[k * n + i] * m_alpha[k];
+            }
+            m_alpha[i] /= m_chol[i * n + i];
+        }
+        if (lml)
+        {
+            *lml = -0.5 * fit - logDet;
+        }
+        return true;
+    }
+
+    double m_offset = 1.0;
+    double m_userMin = 0, m_userRange = 1;
+    double m_capacityMin = 0, m_capacityRange = 1;
+    double m_yMean = 0, m_yScale = 1;
+    Hyper m_hyper;
+    std::vector<Input> m_x;
+    std::vector<double> m_y;
+    std::vector<double> m_noise;
+    std::vector<double> m_chol; // Factor de Cholesky, triangular inferior por filas
+    std::vector<double> m_alpha;
+};
+
+/**
+ * Superficies de retardo, jitter y pérdida, y las consultas que se hacen sobre ellas.
+ *
+ * La probabilidad de cumplir la QoS en un punto es el producto de las probabilidades de que
+ * cada métrica quede por debajo de su umbral según su proceso gaussiano (se suponen
+ * independientes). El bitrate requerido se busca subiendo el bitrate en pasos de 'step' Mbps
+ * dentro del rango simulado, igual que plot-results toma el primer bitrate que cumple.
+ */
+class QosSurrogate
+{
+  public:
+    // Desplazamientos de la escala logarítmica: por debajo de ellos las diferencias no importan
+    static constexpr double DELAY_OFFSET_MS = 0.1;
+    static constexpr double JITTER_OFFSET_MS = 0.1;
+    static constexpr double LOSS_OFFSET_PERCENT = 0.01;
+
+    void Fit(const std::vector<SurrogateCell>& cells)
+    {
+        std::vector<double> users, bitrates, delay, delayVar, jitter, jitterVar, loss, lossVar;
+        for (const SurrogateCell& c : cells)
+        {
+            users.push_back(c.users);
+            bitrates.push_back(c.bitrate);
+            delay.push_back(c.delayMean);
+            delayVar.push_back(c.delayVariance);
+            jitter.push_back(c.jitterMean);
+            jitterVar.push_back(c.jitterVariance);
+            loss.push_back(c.lossMean);
+            lossVar.push_back(c.lossVariance);
+        }
+        m_delay.Fit(users, bitrates, delay, delayVar, DELAY_OFFSET_MS);
+        m_jitter.Fit(users, bitrates, jitter, jitterVar, JITTER_OFFSET_MS);
+        m_loss.Fit(users, bitrates, loss, lossVar, LOSS_OFFSET_PERCENT);
+        m_userMin = *std::min_element(users.begin(), users.end());
+        m_userMax = *std::max_element(users.begin(), users.end());
+        m_bitrateMin = *std::min_element(bitrates.begin(), bitrates.end());
+        m_bitrateMax = *std::max_element(bitrates.begin(), bitrates.end());
+    }
+
+    // Predicción de las tres métricas en su escala original (mediana del proceso gaussiano)
+    void Predict(double users, double bitrate, double& delayMs, double& jitterMs, double& lossPercent) const
+    {
+        double mean, sd;
+        m_delay.Predict(users, bitrate, mean, sd);
+        delayMs = m_delay.Untransform(mean);
+        m_jitter.Predict(users, bitrate, mean, sd);
+        jitterMs = m_jitter.Untransform(mean);
+        m_loss.Predict(users, bitrate, mean, sd);
+        lossPercent = m_loss.Untransform(mean);
+    }
+
+    // 'reducible', si no es nulo, recibe la mayor fracción de la incertidumbre de una métrica
+    // que se reduciría simulando ese punto (véase GaussianSurface::Predict)
+    double Probability(double users, double bitrate, const QosThresholds& qos, double* reducible = nullptr) const
+    {
+        double fraction = 0;
+        double p = Below(m_delay, users, bitrate, qos.delayMs, fraction) *
+                   Below(m_jitter, users, bitrate, qos.jitterMs, fraction) *
+                   Below(m_loss, users, bitrate, qos.lossPercent, fraction);
+        if (reducible)
+        {
+            *reducible = fraction;
+        }
+        return p;
+    }
+
+    // Primer bitrate con probabilidad de cumplir >= 'level', o -1 si no se alcanza en el rango
+    double RequiredBitrate(double users, const QosThresholds& qos, double level, double step) const
+    {
+        for (double b = m_bitrateMin; b <= m_bitrateMax + 1e-9; b += step)
+        {
+            if (Probability(users, b, qos) >= level)
+            {
+                return b;
+            }
+        }
+        return -1;
+    }
+
+    struct Suggestion
+    {
+        double users;
+        double bitrate;
+        double probability;
+    };
+
+    /**
+     * Elige 'count' puntos nuevos donde una simulación más reduciría más la incertidumbre
+     * sobre la frontera de QoS. Se puntúa cada candidato de la rejilla por p·(1-p), siendo p
+     * la probabilidad de cumplir (máxima donde la frontera es más dudosa), por la fracción de
+     * la incertidumbre que se puede reducir simulando allí. Tras elegir un punto se
+     * condicionan las superficies sobre él (Condition) antes de elegir el siguiente.
+     */
+    std::vector<Suggestion> Suggest(size_t count, const QosThresholds& qos, double userStep, double bitrateStep) const
+    {
+        QosSurrogate work = *this;
+        std::vector<Suggestion> chosen;
+        for (size_t s = 0; s < count; ++s)
+        {
+            Suggestion best{0, 0, 0};
+            double bestScore = -1;
+            for (double u = m_userMin; u <= m_userMax + 1e-9; u += userStep)
+            {
+                for (double b = m_bitrateMin; b <= m_bitrateMax + 1e-9; b += bitrateStep)
+                {
+                    bool repeated = std::any_of(chosen.begin(), chosen.end(), [u, b](const Suggestion& c) {
+                        return c.users == u && c.bitrate == b;
+                    });
+                    if (repeated)
+                    {
+                        continue;
+                    }
+                    double reducible;
+                    double p = work.Probability(u, b, qos, &reducible);
+                    double score = p * (1 - p) * reducible;
+                    if (score > bestScore)
+                    {
+                        bestScore = score;
+                        best = {u, b, p};
+                    }
+                }
+            }
+            if (bestScore <= 0)
+            {
+                break;
+            }
+            chosen.push_back(best);
+            work.m_delay.Condition(best.users, best.bitrate);
+            work.m_jitter.Condition(best.users, best.bitrate);
+            work.m_loss.Condition(best.users, best.bitrate);
+        }
+        return chosen;
+    }
+
+    bool InRange(double users) const
+    {
+        return users >= m_userMin && users <= m_userMax;
+    }
+
+    const GaussianSurface& Delay() const
+    {
+        return m_delay;
+    }
+
+    const GaussianSurface& Jitter() const
+    {
+        return m_jitter;
+    }
+
+    const GaussianSurface& Loss() const
+    {
+        return m_loss;
+    }
+
+  private:
+    // P(métrica <= umbral) según la normal predicha en escala logarítmica
+    static double Below(const GaussianSurface& surface, double users, double bitrate, double threshold, double& reducible)
+    {
+        double mean, sd, latentSd;
+        surface.Predict(users, bitrate, mean, sd, &latentSd);
+        reducible = std::max(reducible, latentSd / sd);
+        return 0.5 * std::erfc(-(surface.Transform(threshold) - mean) / (sd * std::sqrt(2.0)));
+    }
+
+    GaussianSurface m_delay;
+    GaussianSurface m_jitter;
+    GaussianSurface m_loss;
+    double m_userMin = 0, m_userMax = 0;
+    double m_bitrateMin = 0, m_bitrateMax = 0;
+};
+
+#endif // RESPONSE_SURFACE_H
@@ -0,0 +1,408 @@
+#ifndef RESULTS_STORE_H
+#define RESULTS_STORE_H
+
+// Almacén binario de resultados compartido por onoffRouting.cc y plot-results.cc.
+//
+// El fichero es una cabecera fija seguida de registros ResultRecord de tamaño fijo. Cada
+// réplica añade su registro con una única llamada write() sobre un descriptor abierto con
+// O_APPEND, que el núcleo posiciona de forma atómica al final del fichero: varios procesos
+// pueden escribir a la vez sin cerrojos y sin que los registros se entremezclen. La cabecera
+// se crea también de forma atómica (fichero temporal + link()), así que nadie puede añadir
+// un registro a un fichero que todavía no la tiene. plot-results lo lee con mmap().
+//
+// Cada versión del esquema solo añade campos al final del registro, así que los ficheros de
+// versiones anteriores se siguen leyendo (los campos nuevos quedan a cero). A un fichero de
+// otra versión no se le añaden registros.
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const uint32_t RESULTS_SCHEMA_VERSION = 4;
+
+struct ResultsFileHeader
+{
+    char magic[8];          // "SNRESULT"
+    uint32_t schemaVersion; // RESULTS_SCHEMA_VERSION
+    uint32_t recordSize;    // sizeof(ResultRecord)
+};
+
+// Una réplica. configHash identifica los parámetros del modelo y la versión del código que
+// la produjeron (ver ConfigHash() en onoffRouting.cc).
+struct ResultRecord
+{
+    uint32_t users;
+    uint32_t seed;
+    double bitrateMbps;
+    double lossRatio; // %
+    double delayMs;
+    double jitterMs;
+    double wallSeconds;
+    uint64_t configHash;
+    int64_t unixTime; // Instante en que terminó la réplica
+    uint32_t flags;   // RESULT_FLAG_*
+    uint32_t run;     // Ejecución del generador (RngSeedManager::SetRun); 0 en los registros anteriores
+    // Versión 2: calidad de experiencia de los clientes DASH (0 con las demás fuentes)
+    double startupDelayS;
+    double rebufferRatio; // %
+    double avgBitrateKbps;
+    // Versión 3: distribución de la QoS entre los usuarios (ver user-qos.h)
+    double usersDelayOk; // Fracción de usuarios con retardo medio <= MAX_DELAY_MS
+    double usersJitterOk;
+    double usersLossOk;
+    double usersOk;     // Fracción de usuarios que cumple los tres umbrales
+    double delayP50Ms;  // Percentiles del retardo de los paquetes de bajada de todos los usuarios
+    double delayP95Ms;
+    double delayP99Ms;
+    double jitterP95Ms;
+    // Versión 4: fracción de las sesiones servidas por las cachés de borde (ver edge-cache.h)
+    double edgeHitRatio;
+};
+
+// La réplica usó variables antitéticas en las fuentes de tráfico
+const uint32_t RESULT_FLAG_ANTITHETIC = 1;
+// El monitor de parada anticipada (--earlyStop) detuvo la réplica: métricas parciales
+const uint32_t RESULT_FLAG_EARLY_STOP = 2;
+// La réplica se detuvo al alcanzar la precisión pedida (--runPrecision): métricas parciales
+const uint32_t RESULT_FLAG_PRECISION_STOP = 4;
+
+static_assert(sizeof(ResultsFileHeader) == 16, "ResultsFileHeader debe ocupar 16 bytes");
+static_assert(sizeof(ResultRecord) == 168, "ResultRecord debe ocupar 168 bytes");
+
+// Tamaño del registro en cada versión del esquema (índice = versión)
+const uint32_t RESULT_RECORD_SIZES[] = {0, 72, 96, 160, 168};
+
+// FNV-1a de 64 bits, para el hash de la configuración
+inline uint64_t
+Fnv1a64(const std::string& data)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+inline ResultsFileHeader
+MakeResultsHeader()
+{
+    ResultsFileHeader header{};
+    std::memcpy(header.magic, "SNRESULT", 8);
+    header.schemaVersion = RESULTS_SCHEMA_VERSION;
+    header.recordSize = sizeof(ResultRecord);
+    return header;
+}
+
+// Cabecera de un fichero legible: esta versión del esquema o una anterior
+inline bool
+IsValidResultsHeader(const ResultsFileHeader& header)
+{
+    return std::memcmp(header.magic, "SNRESULT", 8) == 0 && header.schemaVersion >= 1 &&
+           header.schemaVersion <= RESULTS_SCHEMA_VERSION &&
+           header.recordSize == RESULT_RECORD_SIZES[header.schemaVersion];
+}
+
+// Contenido de un fichero de resultados: almacén binario legible, results.dat de texto o
+// algo que no se puede leer (otra cabecera, un esquema más nuevo, otro fichero binario)
+enum class ResultsFileKind
+{
+    BINARY,
+    TEXT,
+    UNSUPPORTED
+};
+
+// Clasifica el fichero; con UNSUPPORTED, 'reason' dice qué se ha encontrado. Solo se acepta
+// como texto un fichero imprimible cuya primera línea tiene los cinco números de results.dat.
+inline ResultsFileKind
+ClassifyResultsFile(const std::string& path, std::string& reason)
+{
+    std::ifstream in(path, std::ios::binary);
+    char head[4096];
+    in.read(head, sizeof(head));
+    size_t n = in.gcount();
+    if (n >= 8 && std::memcmp(head, "SNRESULT", 8) == 0)
+    {
+        ResultsFileHeader header{};
+        if (n < sizeof(header))
+        {
+            reason = "cabecera de almacén binario incompleta";
+            return ResultsFileKind::UNSUPPORTED;
+        }
+        std::memcpy(&header, head, sizeof(header));
+        if (IsValidResultsHeader(header))
+        {
+            return ResultsFileKind::BINARY;
+        }
+        reason = "almacén binario del esquema " + std::to_string(header.schemaVersion) + " con registros de " +
+                 std::to_string(header.recordSize) + " bytes; este programa lee los esquemas 1 a " +
+                 std::to_string(RESULTS_SCHEMA_VERSION);
+        return ResultsFileKind::UNSUPPORTED;
+    }
+    for (size_t i = 0; i < n; ++i)
+    {
+        unsigned char c = head[i];
+        if ((c < 0x20 || c > 0x7e) && c != '\n' && c != '\r' && c != '\t')
+        {
+            reason = "no es un almacén de resultados (cabecera SNRESULT) ni un results.dat de texto";
+            return ResultsFileKind::UNSUPPORTED;
+        }
+    }
+    std::string firstLine(head, std::find(head, head + n, '\n'));
+    std::istringstream fields(firstLine);
+    double value;
+    int count = 0;
+    while (fields >> value)
+    {
+        ++count;
+    }
+    if (n > 0 && (count < 5 || !fields.eof()))
+    {
+        reason = "fichero de texto que no tiene el formato de results.dat (usuarios bitrate pérdidas retardo jitter)";
+        return ResultsFileKind::UNSUPPORTED;
+    }
+    return ResultsFileKind::TEXT;
+}
+
+// Crea el fichero con su cabecera si no existe. Es seguro llamarla desde varios procesos:
+// la cabecera se escribe en un temporal que se enlaza con link(), que falla si ya existe.
+inline bool
+EnsureResultsFile(const std::string& path)
+{
+    if (access(path.c_str(), F_OK) == 0)
+    {
+        return true;
+    }
+    std::string tmp = path + ".tmp." + std::to_string(getpid());
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    ResultsFileHeader header = MakeResultsHeader();
+    bool ok = write(fd, &header, sizeof(header)) == sizeof(header);
+    close(fd);
+    if (ok && link(tmp.c_str(), path.c_str()) != 0 && errno != EEXIST)
+    {
+        ok = false;
+    }
+    unlink(tmp.c_str());
+    return ok;
+}
+
+// Abre el fichero (creándolo si hace falta) para añadir registros. Devuelve -1 si no se puede
+// o si el fichero es de otra versión del esquema: no se mezclan tamaños de registro.
+inline int
+OpenResultsForAppend(const std::string& path)
+{
+    if (!EnsureResultsFile(path))
+    {
+        return -1;
+    }
+    int fd = open(path.c_str(), O_RDWR | O_APPEND);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    ResultsFileHeader header;
+    if (pread(fd, &header, sizeof(header), 0) != sizeof(header) || header.schemaVersion != RESULTS_SCHEMA_VERSION)
+    {
+        close(fd);
+        errno = EPROTO;
+        return -1;
+    }
+    return fd;
+}
+
+// Añade un registro al final del fichero con una única escritura atómica
+inline bool
+AppendResultRecord(const std::string& path, const ResultRecord& record)
+{
+    int fd = OpenResultsForAppend(path);
+    if (fd < 0)
+    {
+        return false;
+    }
+    ssize_t n = write(fd, &record, sizeof(record));
+    close(fd);
+    return n == sizeof(record);
+}
+
+// Vista de solo lectura de un fichero de resultados proyectado en memoria con mmap()
+class MappedResults
+{
+  public:
+    explicit MappedResults(const std::string& path)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && static_cast<size_t>(st.st_size) >= sizeof(ResultsFileHeader))
+        {
+            void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr != MAP_FAILED)
+            {
+                m_addr = addr;
+                m_length = st.st_size;
+                m_recordSize = static_cast<const ResultsFileHeader*>(addr)->recordSize;
+                madvise(m_addr, m_length, MADV_SEQUENTIAL);
+            }
+        }
+        close(fd);
+        if (m_addr && !IsValidResultsHeader(*static_cast<const ResultsFileHeader*>(m_addr)))
+        {
+            munmap(m_addr, m_length);
+            m_addr = nullptr;
+        }
+    }
+
+    ~MappedResults()
+    {
+        if (m_addr)
+        {
+            munmap(m_addr, m_length);
+        }
+    }
+
+    MappedResults(const MappedResults&) = delete;
+    MappedResults& operator=(const MappedResults&) = delete;
+
+    bool IsValid() const
+    {
+        return m_addr != nullptr;
+    }
+
+    // Tamaño de los registros del fichero (el de su versión del esquema)
+    size_t RecordSize() const
+    {
+        return m_recordSize;
+    }
+
+    // Solo se cuentan los registros completos (un escritor puede estar a mitad de write())
+    size_t Size() const
+    {
+        return m_addr ? (m_length - sizeof(ResultsFileHeader)) / m_recordSize : 0;
+    }
+
+    // Registro i; los campos que no existían en la versión del fichero quedan a cero
+    ResultRecord operator[](size_t i) const
+    {
+        ResultRecord record{};
+        std::memcpy(&record, static_cast<const char*>(m_addr) + sizeof(ResultsFileHeader) + i * m_recordSize,
+                    std::min<size_t>(m_recordSize, sizeof(ResultRecord)));
+        return record;
+    }
+
+  private:
+    void* m_addr = nullptr;
+    size_t m_length = 0;
+    size_t m_recordSize = sizeof(ResultRecord);
+};
+
+// --- CATÁLOGO DE CONFIGURACIONES (<fichero>.configs) ---
+// Los registros solo llevan el hash de su configuración. Junto al almacén se guarda una línea
+// "<hash en hexadecimal> <descripción>" por configuración (ModelDescription en onoffRouting.cc),
+// para que plot-results pueda nombrarlas y elegir una con --config. Las líneas se añaden con
+// una única escritura O_APPEND; una línea repetida por dos escritores a la vez no molesta.
+
+inline std::string
+ConfigHashHex(uint64_t hash)
+{
+    char text[17];
+    std::snprintf(text, sizeof(text), "%016llx", static_cast<unsigned long long>(hash));
+    return text;
+}
+
+inline std::map<uint64_t, std::string>
+ReadConfigCatalogue(const std::string& resultsPath)
+{
+    std::map<uint64_t, std::string> configs;
+    std::ifstream in(resultsPath + ".configs");
+    std::string line;
+    while (std::getline(in, line))
+    {
+        size_t space = line.find(' ');
+        if (space == 16)
+        {
+            configs[std::stoull(line.substr(0, 16), nullptr, 16)] = line.substr(17);
+        }
+    }
+    return configs;
+}
+
+// Añade la configuración al catálogo si todavía no está
+inline void
+RegisterConfig(const std::string& resultsPath, uint64_t hash, const std::string& description)
+{
+    if (ReadConfigCatalogue(resultsPath).count(hash) > 0)
+    {
+        return;
+    }
+    std::string line = ConfigHashHex(hash) + " " + description + "\n";
+    int fd = open((resultsPath + ".configs").c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd >= 0)
+    {
+        ssize_t written = write(fd, line.data(), line.size());
+        (void)written; // Sin catálogo plot-results solo muestra los hashes
+        close(fd);
+    }
+}
+
+// --- CONVERSIÓN CON EL FORMATO DE TEXTO ANTERIOR ---
+// Formato de results.dat: "usuarios bitrate pérdidas retardo jitter" por línea.
+
+inline size_t
+ConvertTextToBinary(const std::string& textPath, const std::string& binaryPath)
+{
+    std::ifstream in(textPath);
+    int fd = in ? OpenResultsForAppend(binaryPath) : -1;
+    if (fd < 0)
+    {
+        return 0;
+    }
+    size_t n = 0;
+    ResultRecord r{};
+    while (in >> r.users >> r.bitrateMbps >> r.lossRatio >> r.delayMs >> r.jitterMs)
+    {
+        // Las filas de texto no guardan semilla, versión ni tiempo: quedan a cero
+        if (write(fd, &r, sizeof(r)) != sizeof(r))
+        {
+            break;
+        }
+        ++n;
+    }
+    close(fd);
+    return n;
+}
+
+inline size_t
+ConvertBinaryToText(const std::string& binaryPath, const std::string& textPath)
+{
+    MappedResults results(binaryPath);
+    std::ofstream out(textPath, std::ios::trunc);
+    for (size_t i = 0; i < results.Size(); ++i)
+    {
+        ResultRecord r = results[i];
+        out << r.users << " " << r.bitrateMbps << " " << r.lossRatio << " " << r.delayMs << " " << r.jitterMs
+            << "\n";
+    }
+    return results.Size();
+}
+
+#endif // RESULTS_STORE_H
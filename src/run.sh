@@ -14,68 +14,126 @@ STEP_USERS=50
 STEP_BITRATE=10
 MAX_USERS=$MAX_USERS_DEFAULT
 MAX_BITRATE=$MAX_BITRATE_DEFAULT
+JOBS=0 # 0 = usar todos los núcleos disponibles
+SEARCH="grid"
+RESOLUTION=1
+SEQUENTIAL_ARGS=""
+SNAPSHOT_ARGS=""
+EARLY_STOP_ARGS=""
+WARMUP_ARGS=""
+CI_RELATIVE=0.05
+BENCH=false
+FRESH=false
 
 # --- PROCESAMIENTO DE OPCIONES ---
 NS3_RUN_PREFIX=""
 ENABLE_LOGS_ARG="" 
 
+# Todo lo que vaya tras "--" se pasa tal cual a onoffRouting (p. ej. -- --serverApp=aggregated)
+SIM_ARGS=""
+SIM_ARGS_MODE=false
+
 declare -a ARGS_FOR_GETOPTS
 for arg in "$@"; do
-    if [[ "$arg" == "--log" ]]; then
+    if $SIM_ARGS_MODE; then
+        SIM_ARGS="$SIM_ARGS $arg"
+    elif [[ "$arg" == "--" ]]; then
+        SIM_ARGS_MODE=true
+    elif [[ "$arg" == "--log" ]]; then
         NS3_RUN_PREFIX='NS_LOG="OnOffRoutingExperiment=all:Rip=info"'
         ENABLE_LOGS_ARG="--enableLogs=true"
         echo "Opción --log detectada. Se activarán los logs detallados de la simulación."
+    elif [[ "$arg" == "--bisect" ]]; then
+        SEARCH="bisect"
+        echo "Opción --bisect detectada. Se buscará el bitrate mínimo por bisección."
+    elif [[ "$arg" == "--bench" ]]; then
+        BENCH=true
+        echo "Opción --bench detectada. Se ejecutará el banco de pruebas de rendimiento."
+    elif [[ "$arg" == "--fresh" ]]; then
+        FRESH=true
+        echo "Opción --fresh detectada. Se vaciará la caché de réplicas y se simulará todo de nuevo."
+    elif [[ "$arg" == "--snapshot" ]]; then
+        SNAPSHOT_ARGS="--snapshot=true"
+        echo "Opción --snapshot detectada. El escenario se construirá una vez por número de usuarios."
+    elif [[ "$arg" == "--earlyStop" ]]; then
+        EARLY_STOP_ARGS="--earlyStop=true"
+        echo "Opción --earlyStop detectada. Las réplicas con la QoS ya decidida se detendrán antes del final."
+    elif [[ "$arg" == "--warmup" ]]; then
+        WARMUP_ARGS="--warmup=true"
+        echo "Opción --warmup detectada. Se descartará el transitorio inicial de cada réplica (MSER)."
+    elif [[ "$arg" == "--sequential" ]]; then
+        SEQUENTIAL_ARGS="--sequential=true"
+        echo "Opción --sequential detectada. Se añadirán réplicas hasta alcanzar la precisión pedida (máximo N)."
     else
         ARGS_FOR_GETOPTS+=("$arg")
     fi
 done
 set -- "${ARGS_FOR_GETOPTS[@]}"
 
-while getopts "u:b:n:" opt; do
+while getopts "u:b:n:j:r:c:" opt; do
   case $opt in
     u) MAX_USERS="$OPTARG"; echo "Tope de usuarios personalizado: $MAX_USERS"; ;;
     b) MAX_BITRATE="$OPTARG"; echo "Tope de bitrate personalizado: $MAX_BITRATE Mbps"; ;;
     n) N="$OPTARG"; echo "Se ejecutarán $N simulaciones por muestra"; ;;
+    j) JOBS="$OPTARG"; echo "Se usarán $JOBS procesos en paralelo"; ;;
+    r) RESOLUTION="$OPTARG"; echo "Resolución de la bisección: $RESOLUTION Mbps"; ;;
+    c) CI_RELATIVE="$OPTARG"; echo "Semiancho relativo objetivo del IC del 95%: $CI_RELATIVE"; ;;
     \?) echo "Opción inválida: -$OPTARG" >&2; exit 1; ;;
     :) echo "La opción -$OPTARG requiere un argumento." >&2; exit 1; ;;
   esac
 done
 
+# --- BANCO DE PRUEBAS DE RENDIMIENTO ---
+# No toca los resultados del barrido. Con -- --benchBaseline=<fichero.json> termina con
+# error si algún caso es más lento o usa más memoria que la referencia.
+if $BENCH; then
+    ./ns3 build || exit 1
+    ./ns3 run "scratch/onoffRouting" -- --benchmark=true --jobs=$JOBS $SIM_ARGS
+    exit $?
+fi
+
 # --- PREPARACIÓN DEL ENTORNO ---
-RESULTS_FILE="results.dat"
+RESULTS_FILE="results.bin"
+# La caché conserva todas las réplicas entre ejecuciones: results.bin se rehace en cada
+# barrido, pero las réplicas con la misma configuración, semilla y ejecución salen de aquí
+CACHE_FILE="results-cache.bin"
 GRAFICAS_DIR="graficas"
 GRAFICAS_PRECISION_DIR="graficas-precision"
 echo "Limpiando entorno anterior..."
-rm -f $RESULTS_FILE $RESULTS_FILE_PRECISION
-rm -rf $GRAFICAS_DIR $GRAFICAS_PRECISION_DIR
-touch $RESULTS_FILE
+# results.*.bin* son los ficheros de cada variante de --qdiscs, --edgeCaches o --tcps
+rm -f $RESULTS_FILE $RESULTS_FILE.idx $RESULTS_FILE.*.idx $RESULTS_FILE.configs results.*.bin results.*.bin.* sim_precision*.dat $RESULTS_FILE_PRECISION required_bitrate.dat
+rm -rf $GRAFICAS_DIR $GRAFICAS_PRECISION_DIR $GRAFICAS_DIR-*
+if $FRESH; then
+    rm -f $CACHE_FILE $CACHE_FILE.configs
+fi
 echo "Compilando los programas de simulación y ploteo..."
 ./ns3 build
 
-# --- BUCLE PRINCIPAL DE SIMULACIÓN ---
-for users in $(seq $MIN_USERS $STEP_USERS $MAX_USERS)
-do
-  echo "----------------------------------------------------"
-  echo "Ejecutando simulaciones para $users usuarios..."
-  echo "----------------------------------------------------"
-  for bitrate_val in $(seq $MIN_BITRATE $STEP_BITRATE $MAX_BITRATE)
-  do
-    bitrate_str="${bitrate_val}Mbps"
-    echo "  -> Bitrate: $bitrate_str"
-    for i in $(seq 1 $N)
-    do
-      semilla=$(($users + $bitrate_val + $i)) 
-      echo "    -> Ejecutando réplica $i/$N..."
-      
-      
-      eval $NS3_RUN_PREFIX ./ns3 run "scratch/onoffRouting" -- --num_usuarios=$users --bitrate=$bitrate_str --semilla=$semilla $ENABLE_LOGS_ARG
-    done
-  done
-done
+# --- BARRIDO PRINCIPAL DE SIMULACIÓN ---
+# Un único proceso de ns-3 reparte la rejilla (usuarios x bitrate x réplicas)
+# entre un pool de procesos hijo, uno por núcleo salvo que se indique -j.
+eval $NS3_RUN_PREFIX ./ns3 run "scratch/onoffRouting" -- --sweep=true \
+  --minUsers=$MIN_USERS --maxUsers=$MAX_USERS --stepUsers=$STEP_USERS \
+  --minBitrate=$MIN_BITRATE --maxBitrate=$MAX_BITRATE --stepBitrate=$STEP_BITRATE \
+  --replicas=$N --jobs=$JOBS --resultsFile=$RESULTS_FILE --cacheFile=$CACHE_FILE \
+  --search=$SEARCH --resolution=$RESOLUTION \
+  $SEQUENTIAL_ARGS $SNAPSHOT_ARGS $EARLY_STOP_ARGS $WARMUP_ARGS --maxReplicas=$N --ciRelative=$CI_RELATIVE $ENABLE_LOGS_ARG $SIM_ARGS
 
 echo ""
 echo "Todas las simulaciones han completado."
 echo "Generando gráficas finales..."
-./ns3 run scratch/plot-results
-echo ""
-echo "Proceso finalizado. Revisa la carpeta '$GRAFICAS_DIR'."
+VARIANT_FILES=$(ls results.*.bin 2>/dev/null)
+if [ -z "$VARIANT_FILES" ]; then
+    ./ns3 run scratch/plot-results
+    echo ""
+    echo "Proceso finalizado. Revisa la carpeta '$GRAFICAS_DIR'."
+else
+    # Una comparación de variantes: cada una tiene su fichero y sus gráficas
+    for f in $VARIANT_FILES; do
+        VARIANT=${f#results.}
+        VARIANT=${VARIANT%.bin}
+        ./ns3 run scratch/plot-results -- --resultsFile=$f --label=$VARIANT
+    done
+    echo ""
+    echo "Proceso finalizado. Revisa las carpetas '$GRAFICAS_DIR-<variante>' y required_bitrate.dat."
+fi
@@ -0,0 +1,119 @@
+#ifndef TCP_CONFIG_H
+#define TCP_CONFIG_H
+
+#include "ns3/abort.h"
+#include "ns3/boolean.h"
+#include "ns3/config.h"
+#include "ns3/type-id.h"
+#include "ns3/uinteger.h"
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+
+namespace ns3
+{
+
+// --- CONTROL DE CONGESTIÓN Y PACING DE TCP (--tcp, --pacing, --initialCwnd, --tcpSndBuf, --tcpRcvBuf) ---
+// Se aplica como valor por defecto de los atributos de ns-3, así que afecta a todos los sockets
+// TCP de la réplica: las fuentes de streaming y también los receptores, que con DCTCP deben
+// devolver las marcas ECN. Los ceros y la variante vacía (o 'default') dejan el valor por
+// defecto de ns-3, que depende de su versión.
+struct TcpConfig
+{
+    std::string variant;      // newreno, cubic, bbr, dctcp o un TypeId completo de ns-3 ("" = el de ns-3)
+    bool pacing = false;      // Envío espaciado a la tasa de pacing (BBR lo activa siempre)
+    uint32_t initialCwnd = 0; // Ventana inicial (segmentos)
+    uint32_t sndBuf = 0;      // Buffer de envío de cada socket (bytes)
+    uint32_t rcvBuf = 0;      // Buffer de recepción de cada socket (bytes)
+
+    // La configuración de siempre: no cambia la descripción del modelo
+    bool IsDefault() const
+    {
+        return variant.empty() && !pacing && initialCwnd == 0 && sndBuf == 0 && rcvBuf == 0;
+    }
+};
+
+inline std::string
+TcpVariantTypeId(const std::string& name)
+{
+    static const std::map<std::string, std::string> typeIds = {
+        {"newreno", "ns3::TcpNewReno"},
+        {"cubic", "ns3::TcpCubic"},
+        {"bbr", "ns3::TcpBbr"},
+        {"dctcp", "ns3::TcpDctcp"},
+        {"default", ""},
+        {"", ""},
+    };
+    auto known = typeIds.find(name);
+    if (known != typeIds.end())
+    {
+        return known->second;
+    }
+    NS_ABORT_MSG_UNLESS(name.rfind("ns3::", 0) == 0,
+                        "--tcp: variante desconocida '" << name << "' (newreno, cubic, bbr o dctcp)");
+    return name;
+}
+
+// Elemento de --tcps: "<variante>" o "<variante>+pacing" ('default' = la de ns-3)
+inline TcpConfig
+ParseTcpVariant(const std::string& text, TcpConfig base)
+{
+    size_t plus = text.find('+');
+    base.variant = text.substr(0, plus) == "default" ? "" : text.substr(0, plus);
+    base.pacing = false;
+    if (plus != std::string::npos)
+    {
+        NS_ABORT_MSG_UNLESS(text.substr(plus + 1) == "pacing", "--tcps: se esperaba '<variante>' o '<variante>+pacing' en '" << text << "'");
+        base.pacing = true;
+    }
+    TcpVariantTypeId(base.variant); // Valida el nombre
+    return base;
+}
+
+// Fija los valores por defecto antes de crear la pila de red y los sockets de la réplica
+inline void
+ApplyTcpConfig(const TcpConfig& tcp)
+{
+    std::string name = TcpVariantTypeId(tcp.variant);
+    if (!name.empty())
+    {
+        TypeId tid;
+        NS_ABORT_MSG_UNLESS(TypeId::LookupByNameFailSafe(name, &tid), "--tcp: este ns-3 no tiene " << name);
+        Config::SetDefault("ns3::TcpL4Protocol::SocketType", TypeIdValue(tid));
+    }
+    Config::SetDefault("ns3::TcpSocketState::EnablePacing", BooleanValue(tcp.pacing));
+    if (tcp.initialCwnd > 0)
+    {
+        Config::SetDefault("ns3::TcpSocket::InitialCwnd", UintegerValue(tcp.initialCwnd));
+    }
+    if (tcp.sndBuf > 0)
+    {
+        Config::SetDefault("ns3::TcpSocket::SndBufSize", UintegerValue(tcp.sndBuf));
+    }
+    if (tcp.rcvBuf > 0)
+    {
+        Config::SetDefault("ns3::TcpSocket::RcvBufSize", UintegerValue(tcp.rcvBuf));
+    }
+}
+
+// Descripción canónica, para ModelDescription()
+inline std::ostream&
+operator<<(std::ostream& os, const TcpConfig& tcp)
+{
+    os << (tcp.variant.empty() ? "default" : tcp.variant) << (tcp.pacing ? ",pacing" : "");
+    if (tcp.initialCwnd > 0)
+    {
+        os << ",iw=" << tcp.initialCwnd;
+    }
+    if (tcp.sndBuf > 0 || tcp.rcvBuf > 0)
+    {
+        os << ",buffers=" << tcp.sndBuf << "/" << tcp.rcvBuf;
+    }
+    return os;
+}
+
+} // namespace ns3
+
+#endif // TCP_CONFIG_H
@@ -0,0 +1,646 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#include "ns3/abort.h"
+#include "ns3/csma-channel.h"
+#include "ns3/csma-helper.h"
+#include "ns3/csma-net-device.h"
+#include "ns3/inet-socket-address.h"
+#include "ns3/data-rate.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/ipv4-interface-container.h"
+#include "ns3/net-device-container.h"
+#include "ns3/node-container.h"
+#include "ns3/nstime.h"
+#include "ns3/point-to-point-helper.h"
+#include "ns3/point-to-point-net-device.h"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace ns3
+{
+
+// --- DESCRIPCIÓN DE LA TOPOLOGÍA ---
+// Servidor -- router1 (núcleo) -- un router por región -- LAN de usuarios de la región.
+//
+// Fichero de texto por secciones (ver topology.txt), con '#' para comentarios:
+//
+//   [global]
+//   activeFraction = 0.4                 # Fracción de usuarios de cada clase con sesión
+//   serverLink = 1Gbps 0ms 10.1.1.0/24   # Enlace servidor - router1: tasa retardo [red]
+//   linkPool = 20.0.0.0/8                # Redes de los enlaces sin red explícita
+//   lanPool = 40.0.0.0/6                 # Redes de las LAN sin red explícita
+//
+//   [class FHD]
+//   rate = 800kb/s                       # Tasa de cada sesión de la clase
+//
+//   [region Valencia]
+//   share = 0.7                          # Fracción de --num_usuarios (o users = N fijo)
+//   mix = FHD:0.7 HD:0.2 SD:0.1          # Reparto de los usuarios de la región por clase
+//   uplink = bottleneck 0ms 20.1.1.0/24  # Enlace router1 - región ('bottleneck' = --bitrate)
+//   lan = 100Mbps 0ms 40.1.0.0/22        # LAN de usuarios de la región
+//   access = csma                        # Red de acceso (también en [global], para todas)
+//
+// Las redes son opcionales: si se omiten se reservan del pool correspondiente con el
+// prefijo justo para el número de equipos, así que no hay límite fijo de usuarios por región.
+//
+// Red de acceso de cada región:
+//   access = csma           -> Todos los usuarios en un único segmento CSMA con el router de la
+//                              región. Cada trama llega a todos los dispositivos del canal, así
+//                              que el coste por paquete crece con el número de usuarios.
+//   access = aggregated S   -> Nodos de abonado agregados: cada nodo representa S usuarios
+//                              (S sesiones TCP en puertos consecutivos) y se une al router con
+//                              un enlace punto a punto con los parámetros de 'lan'. El coste por
+//                              paquete no depende del número de usuarios. Con S igual al número
+//                              de usuarios de la región se comparte un único enlace, como en CSMA.
+
+struct LinkSpec
+{
+    bool bottleneck = false; // La tasa es la del barrido (--bitrate)
+    DataRate rate;
+    Time delay;
+    std::string network; // "a.b.c.d/len", o vacío para reservarla del pool
+};
+
+struct TrafficClassSpec
+{
+    std::string name;
+    DataRate rate;
+};
+
+struct RegionSpec
+{
+    std::string name;
+    double share = 0;       // Fracción del total de usuarios
+    uint32_t users = 0;     // Número fijo de usuarios (si no es 0, se ignora share)
+    std::vector<double> mix; // Fracción de usuarios por clase, en el orden de TopologySpec::classes
+    LinkSpec uplink;
+    LinkSpec lan;
+    uint32_t sessionsPerNode = 0; // 0 = access csma; S > 0 = access aggregated S
+};
+
+struct TopologySpec
+{
+    double activeFraction = 0.4;
+    LinkSpec serverLink;
+    std::string linkPool = "20.0.0.0/8";
+    std::string lanPool = "40.0.0.0/6";
+    std::vector<TrafficClassSpec> classes;
+    std::vector<RegionSpec> regions;
+};
+
+// Escenario original: Valencia (70%) tras el enlace cuello de botella y Baleares (30%)
+inline TopologySpec
+DefaultTopologySpec()
+{
+    TopologySpec spec;
+    spec.serverLink = {false, DataRate("1Gbps"), Seconds(0), "10.1.1.0/24"};
+    spec.classes = {{"FHD", DataRate("800kb/s")}, {"HD", DataRate("500kb/s")}, {"SD", DataRate("200kb/s")}};
+    RegionSpec valencia;
+    valencia.name = "Valencia";
+    valencia.share = 0.7;
+    valencia.mix = {0.7, 0.2, 0.1};
+    valencia.uplink = {true, DataRate(), Seconds(0), "20.1.1.0/24"};
+    valencia.lan = {false, DataRate("100Mbps"), Seconds(0), "40.1.0.0/22"};
+    RegionSpec baleares = valencia;
+    baleares.name = "Baleares";
+    baleares.share = 0.3;
+    baleares.uplink = {false, DataRate("1Gbps"), Seconds(0), "30.1.1.0/24"};
+    baleares.lan.network = "50.1.0.0/22";
+    spec.regions = {valencia, baleares};
+    return spec;
+}
+
+inline std::string
+TrimTopologyToken(const std::string& s)
+{
+    size_t first = s.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+    {
+        return "";
+    }
+    return s.substr(first, s.find_last_not_of(" \t\r") - first + 1);
+}
+
+// "<tasa|bottleneck> <retardo> [red]"
+inline LinkSpec
+ParseLinkSpec(const std::string& value, const std::string& where)
+{
+    std::istringstream in(value);
+    std::string rate, delay, network;
+    NS_ABORT_MSG_UNLESS(in >> rate >> delay, where << ": se esperaba '<tasa|bottleneck> <retardo> [red]'");
+    in >> network;
+    LinkSpec link;
+    link.bottleneck = rate == "bottleneck";
+    if (!link.bottleneck)
+    {
+        link.rate = DataRate(rate);
+    }
+    link.delay = Time(delay);
+    link.network = network;
+    return link;
+}
+
+// "csma" o "aggregated <S>"
+inline uint32_t
+ParseAccessSpec(const std::string& value, const std::string& where)
+{
+    std::istringstream in(value);
+    std::string mode;
+    uint32_t sessions = 0;
+    in >> mode;
+    if (mode == "aggregated" && in >> sessions && sessions > 0)
+    {
+        return sessions;
+    }
+    NS_ABORT_MSG_UNLESS(mode == "csma", where << ": se esperaba 'access = csma' o 'access = aggregated <sesiones por nodo>'");
+    return 0;
+}
+
+inline TopologySpec
+LoadTopologySpec(const std::string& fileName)
+{
+    std::ifstream in(fileName);
+    NS_ABORT_MSG_UNLESS(in, "No se puede abrir el fichero de topología " << fileName);
+
+    TopologySpec spec;
+    std::string section, name, line;
+    std::vector<std::string> pendingMix; // Los mix se resuelven al final, cuando se conocen todas las clases
+    std::vector<bool> hasAccess;         // Las regiones sin 'access' heredan el de [global]
+    uint32_t globalSessionsPerNode = 0;
+    for (uint32_t lineNo = 1; std::getline(in, line); ++lineNo)
+    {
+        std::string where = fileName + ":" + std::to_string(lineNo);
+        line = TrimTopologyToken(line.substr(0, line.find('#')));
+        if (line.empty())
+        {
+            continue;
+        }
+        if (line.front() == '[')
+        {
+            NS_ABORT_MSG_UNLESS(line.back() == ']', where << ": sección mal cerrada");
+            std::istringstream header(line.substr(1, line.size() - 2));
+            header >> section;
+            std::getline(header, name);
+            name = TrimTopologyToken(name);
+            if (section == "class")
+            {
+                spec.classes.push_back({name, DataRate()});
+            }
+            else if (section == "region")
+            {
+                spec.regions.push_back(RegionSpec());
+                spec.regions.back().name = name;
+                pendingMix.push_back("");
+                hasAccess.push_back(false);
+            }
+            else
+            {
+                NS_ABORT_MSG_UNLESS(section == "global", where << ": sección desconocida '" << section << "'");
+            }
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        NS_ABORT_MSG_IF(eq == std::string::npos, where << ": se esperaba 'clave = valor'");
+        std::string key = TrimTopologyToken(line.substr(0, eq));
+        std::string value = TrimTopologyToken(line.substr(eq + 1));
+        if (section == "global" && key == "activeFraction")
+        {
+            spec.activeFraction = std::stod(value);
+        }
+        else if (section == "global" && key == "serverLink")
+        {
+            spec.serverLink = ParseLinkSpec(value, where);
+        }
+        else if (section == "global" && key == "linkPool")
+        {
+            spec.linkPool = value;
+        }
+        else if (section == "global" && key == "lanPool")
+        {
+            spec.lanPool = value;
+        }
+        else if (section == "global" && key == "access")
+        {
+            globalSessionsPerNode = ParseAccessSpec(value, where);
+        }
+        else if (section == "region" && key == "access")
+        {
+            spec.regions.back().sessionsPerNode = ParseAccessSpec(value, where);
+            hasAccess.back() = true;
+        }
+        else if (section == "class" && key == "rate")
+        {
+            spec.classes.back().rate = DataRate(value);
+        }
+        else if (section == "region" && key == "share")
+        {
+            spec.regions.back().share = std::stod(value);
+        }
+        else if (section == "region" && key == "users")
+        {
+            spec.regions.back().users = std::stoul(value);
+        }
+        else if (section == "region" && key == "mix")
+        {
+            pendingMix.back() = where + "|" + value;
+        }
+        else if (section == "region" && key == "uplink")
+        {
+            spec.regions.back().uplink = ParseLinkSpec(value, where);
+        }
+        else if (section == "region" && key == "lan")
+        {
+            spec.regions.back().lan = ParseLinkSpec(value, where);
+        }
+        else
+        {
+            NS_FATAL_ERROR(where << ": clave desconocida '" << key << "' en la sección [" << section << "]");
+        }
+    }
+
+    NS_ABORT_MSG_IF(spec.classes.empty(), fileName << ": no se ha definido ninguna [class]");
+    NS_ABORT_MSG_IF(spec.regions.empty(), fileName << ": no se ha definido ninguna [region]");
+    for (size_t r = 0; r < spec.regions.size(); ++r)
+    {
+        RegionSpec& region = spec.regions[r];
+        if (!hasAccess[r])
+        {
+            region.sessionsPerNode = globalSessionsPerNode;
+        }
+        region.mix.assign(spec.classes.size(), 0.0);
+        NS_ABORT_MSG_IF(pendingMix[r].empty(), fileName << ": la región " << region.name << " no tiene 'mix'");
+        std::string where = pendingMix[r].substr(0, pendingMix[r].find('|'));
+        std::istringstream entries(pendingMix[r].substr(pendingMix[r].find('|') + 1));
+        std::string entry;
+        while (entries >> entry)
+        {
+            size_t colon = entry.find(':');
+            NS_ABORT_MSG_IF(colon == std::string::npos, where << ": se esperaba 'clase:fracción' en '" << entry << "'");
+            std::string className = entry.substr(0, colon);
+            size_t c = 0;
+            while (c < spec.classes.size() && spec.classes[c].name != className)
+            {
+                ++c;
+            }
+            NS_ABORT_MSG_IF(c == spec.classes.size(), where << ": clase desconocida '" << className << "'");
+            region.mix[c] = std::stod(entry.substr(colon + 1));
+        }
+    }
+    return spec;
+}
+
+inline void
+WriteLinkSpec(std::ostream& os, const LinkSpec& link)
+{
+    if (link.bottleneck)
+    {
+        os << "bottleneck";
+    }
+    else
+    {
+        os << link.rate;
+    }
+    os << " " << link.delay.GetSeconds() << "s";
+    if (!link.network.empty())
+    {
+        os << " " << link.network;
+    }
+}
+
+// Escribe la topología en el formato de LoadTopologySpec (también se usa para el hash de configuración)
+inline std::ostream&
+operator<<(std::ostream& os, const TopologySpec& spec)
+{
+    os << "[global]\n";
+    os << "activeFraction = " << spec.activeFraction << "\n";
+    os << "serverLink = ";
+    WriteLinkSpec(os, spec.serverLink);
+    os << "\nlinkPool = " << spec.linkPool << "\nlanPool = " << spec.lanPool << "\n";
+    for (const auto& c : spec.classes)
+    {
+        os << "\n[class " << c.name << "]\nrate = " << c.rate << "\n";
+    }
+    for (const auto& r : spec.regions)
+    {
+        os << "\n[region " << r.name << "]\n";
+        if (r.users > 0)
+        {
+            os << "users = " << r.users << "\n";
+        }
+        else
+        {
+            os << "share = " << r.share << "\n";
+        }
+        os << "mix =";
+        for (size_t c = 0; c < spec.classes.size(); ++c)
+        {
+            os << " " << spec.classes[c].name << ":" << r.mix[c];
+        }
+        os << "\nuplink = ";
+        WriteLinkSpec(os, r.uplink);
+        os << "\nlan = ";
+        WriteLinkSpec(os, r.lan);
+        if (r.sessionsPerNode > 0)
+        {
+            os << "\naccess = aggregated " << r.sessionsPerNode;
+        }
+        else
+        {
+            os << "\naccess = csma";
+        }
+        os << "\n";
+    }
+    return os;
+}
+
+// --- PLAN DE DIRECCIONES ---
+
+// Reparte bloques alineados consecutivos de un pool "a.b.c.d/len"
+class AddressPool
+{
+  public:
+    explicit AddressPool(const std::string& pool)
+    {
+        size_t slash = pool.find('/');
+        NS_ABORT_MSG_IF(slash == std::string::npos, "Pool de direcciones sin prefijo: " << pool);
+        m_next = Ipv4Address(pool.substr(0, slash).c_str()).Get();
+        uint32_t len = std::stoul(pool.substr(slash + 1));
+        m_end = static_cast<uint64_t>(m_next) + (uint64_t(1) << (32 - len));
+    }
+
+    // Devuelve la red "a.b.c.d/len" más pequeña que admite 'hosts' equipos
+    std::string Allocate(uint32_t hosts)
+    {
+        uint32_t hostBits = std::max<uint32_t>(2, std::ceil(std::log2(hosts + 2.0)));
+        uint64_t size = uint64_t(1) << hostBits;
+        uint64_t base = (m_next + size - 1) / size * size;
+        NS_ABORT_MSG_IF(base + size > m_end, "Pool de direcciones agotado al reservar " << hosts << " equipos");
+        m_next = base + size;
+        std::ostringstream network;
+        network << Ipv4Address(static_cast<uint32_t>(base)) << "/" << (32 - hostBits);
+        return network.str();
+    }
+
+  private:
+    uint64_t m_next;
+    uint64_t m_end;
+};
+
+inline void
+SetNetworkBase(Ipv4AddressHelper& helper, const std::string& network)
+{
+    size_t slash = network.find('/');
+    NS_ABORT_MSG_IF(slash == std::string::npos, "Red sin prefijo: " << network);
+    helper.SetBase(Ipv4Address(network.substr(0, slash).c_str()), Ipv4Mask(network.substr(slash).c_str()));
+}
+
+// --- CONSTRUCCIÓN ---
+
+// Región construida. Los usuarios se numeran 0..numUsers-1, ordenados por clase; el usuario u
+// está en el nodo users.Get(u / sessionsPerNode) y su sesión usa el puerto port + u % sessionsPerNode.
+struct BuiltRegion
+{
+    std::string name;
+    uint16_t port;                       // Puerto del PacketSink del primer usuario de cada nodo
+    Ptr<Node> router;
+    NodeContainer users;                 // Nodos de usuario (o de abonado agregado)
+    uint32_t numUsers = 0;
+    uint32_t sessionsPerNode = 1;        // 1 en csma
+    std::vector<uint32_t> classUsers;    // Usuarios de cada clase
+    NetDeviceContainer uplinkDevices;    // 0 = router1, 1 = router de la región
+    Ipv4InterfaceContainer uplinkInterfaces;
+    std::vector<Ipv4Address> nodeAddresses; // Dirección de cada nodo de users
+    std::vector<Ipv4Address> nodeGateways;  // Dirección del router de la región vista por cada nodo
+    uint32_t nodeAddressStride = 1;         // Distancia entre direcciones de nodos consecutivos
+    std::string lanNetwork;
+    uint32_t uplinkInterface;             // Índice de la interfaz de router1 hacia la región
+
+    InetSocketAddress SessionAddress(uint32_t user) const
+    {
+        return InetSocketAddress(nodeAddresses[user / sessionsPerNode], port + user % sessionsPerNode);
+    }
+};
+
+// Proceso MPI que simula la región r cuando la simulación se reparte entre numRanks procesos:
+// el servidor y router1 van en el 0 y las regiones se reparten entre los demás.
+inline uint32_t
+RegionRank(size_t r, uint32_t numRanks)
+{
+    return numRanks > 1 ? 1 + r % (numRanks - 1) : 0;
+}
+
+struct BuiltTopology
+{
+    Ptr<Node> server;
+    Ptr<Node> core; // router1
+    NodeContainer allNodes;
+    Ipv4InterfaceContainer serverInterfaces; // 0 = servidor, 1 = router1
+    std::vector<BuiltRegion> regions;
+    NetDeviceContainer bottleneckDevices; // Primer enlace marcado como 'bottleneck'
+    NetDeviceContainer rateDevices;       // Todos los dispositivos de enlaces 'bottleneck'
+    uint32_t totalUsers = 0;
+};
+
+/**
+ * Crea nodos, enlaces y direcciones a partir de la descripción. Los nodos se crean en el
+ * orden servidor, router1, routers de región y usuarios de cada región, y los canales en el
+ * orden servidor, enlaces de región y redes de acceso, de modo que con DefaultTopologySpec()
+ * la red es idéntica a la del escenario original.
+ *
+ * Con numRanks > 1 (simulación distribuida) cada región se asigna a un proceso con RegionRank()
+ * y los enlaces router1 - región pasan a ser punto a punto, los únicos que pueden cruzar de un
+ * proceso a otro; su retardo es el lookahead del simulador distribuido, así que no puede ser 0.
+ */
+inline BuiltTopology
+BuildTopology(const TopologySpec& spec, uint32_t numUsers, DataRate bottleneckRate, InternetStackHelper& stack, uint32_t numRanks = 1)
+{
+    BuiltTopology topo;
+    NodeContainer serverNode, routerNodes;
+    serverNode.Create(1);
+    routerNodes.Create(1);
+    for (size_t r = 0; r < spec.regions.size(); ++r)
+    {
+        routerNodes.Create(1, RegionRank(r, numRanks));
+    }
+    topo.server = serverNode.Get(0);
+    topo.core = routerNodes.Get(0);
+    topo.allNodes.Add(serverNode);
+    topo.allNodes.Add(routerNodes);
+
+    for (size_t r = 0; r < spec.regions.size(); ++r)
+    {
+        const RegionSpec& rs = spec.regions[r];
+        BuiltRegion region;
+        region.name = rs.name;
+        region.port = 9 + r;
+        region.router = routerNodes.Get(1 + r);
+        uint32_t regionUsers = 0;
+        for (double mix : rs.mix)
+        {
+            uint32_t n = rs.users > 0 ? rs.users * mix : numUsers * mix * rs.share;
+            region.classUsers.push_back(n);
+            regionUsers += n;
+        }
+        region.numUsers = regionUsers;
+        region.sessionsPerNode = std::max<uint32_t>(1, rs.sessionsPerNode);
+        if (regionUsers > 0)
+        {
+            region.users.Create((regionUsers + region.sessionsPerNode - 1) / region.sessionsPerNode, RegionRank(r, numRanks));
+        }
+        topo.allNodes.Add(region.users);
+        topo.totalUsers += regionUsers;
+        topo.regions.push_back(region);
+    }
+    stack.Install(topo.allNodes);
+
+    CsmaHelper csma;
+    Ipv4AddressHelper ipHelper;
+    AddressPool linkPool(spec.linkPool), lanPool(spec.lanPool);
+    auto install = [&](const LinkSpec& link, NodeContainer nodes, AddressPool& pool, std::string& network) {
+        csma.SetChannelAttribute("DataRate", DataRateValue(link.bottleneck ? bottleneckRate : link.rate));
+        csma.SetChannelAttribute("Delay", TimeValue(link.delay));
+        if (network.empty())
+        {
+            network = pool.Allocate(nodes.GetN());
+        }
+        SetNetworkBase(ipHelper, network);
+        NetDeviceContainer devices = csma.Install(nodes);
+        if (link.bottleneck)
+        {
+            topo.rateDevices.Add(devices);
+        }
+        return devices;
+    };
+
+    std::string serverNetwork = spec.serverLink.network;
+    topo.serverInterfaces = ipHelper.Assign(install(spec.serverLink, NodeContainer(topo.server, topo.core), linkPool, serverNetwork));
+    for (size_t r = 0; r < spec.regions.size(); ++r)
+    {
+        BuiltRegion& region = topo.regions[r];
+        const LinkSpec& uplink = spec.regions[r].uplink;
+        std::string network = uplink.network;
+        if (numRanks > 1)
+        {
+            NS_ABORT_MSG_IF(uplink.delay.IsZero(), "Simulación distribuida: el enlace de la región " << region.name << " necesita un retardo mayor que 0");
+            PointToPointHelper remote;
+            remote.SetDeviceAttribute("DataRate", DataRateValue(uplink.bottleneck ? bottleneckRate : uplink.rate));
+            remote.SetChannelAttribute("Delay", TimeValue(uplink.delay));
+            if (network.empty())
+            {
+                network = linkPool.Allocate(2);
+            }
+            SetNetworkBase(ipHelper, network);
+            region.uplinkDevices = remote.Install(topo.core, region.router);
+            if (uplink.bottleneck)
+            {
+                topo.rateDevices.Add(region.uplinkDevices);
+            }
+        }
+        else
+        {
+            region.uplinkDevices = install(uplink, NodeContainer(topo.core, region.router), linkPool, network);
+        }
+        region.uplinkInterfaces = ipHelper.Assign(region.uplinkDevices);
+        region.uplinkInterface = 2 + r;
+        if (spec.regions[r].uplink.bottleneck && topo.bottleneckDevices.GetN() == 0)
+        {
+            topo.bottleneckDevices = region.uplinkDevices;
+        }
+    }
+    PointToPointHelper p2p;
+    for (size_t r = 0; r < spec.regions.size(); ++r)
+    {
+        BuiltRegion& region = topo.regions[r];
+        const LinkSpec& lan = spec.regions[r].lan;
+        uint32_t nodes = region.users.GetN();
+        if (nodes == 0)
+        {
+            continue;
+        }
+        region.lanNetwork = lan.network;
+        if (spec.regions[r].sessionsPerNode == 0)
+        {
+            Ipv4InterfaceContainer lanInterfaces = ipHelper.Assign(install(lan, NodeContainer(region.router, region.users), lanPool, region.lanNetwork));
+            for (uint32_t i = 0; i < nodes; ++i)
+            {
+                region.nodeAddresses.push_back(lanInterfaces.GetAddress(i + 1));
+                region.nodeGateways.push_back(lanInterfaces.GetAddress(0));
+            }
+            continue;
+        }
+
+        // Un enlace punto a punto por nodo agregado, con una /30 consecutiva de la red de la región
+        if (region.lanNetwork.empty())
+        {
+            region.lanNetwork = lanPool.Allocate(4 * nodes - 2);
+        }
+        AddressPool links(region.lanNetwork);
+        p2p.SetDeviceAttribute("DataRate", DataRateValue(lan.bottleneck ? bottleneckRate : lan.rate));
+        p2p.SetChannelAttribute("Delay", TimeValue(lan.delay));
+        for (uint32_t i = 0; i < nodes; ++i)
+        {
+            SetNetworkBase(ipHelper, links.Allocate(2));
+            NetDeviceContainer devices = p2p.Install(region.router, region.users.Get(i));
+            if (lan.bottleneck)
+            {
+                topo.rateDevices.Add(devices);
+            }
+            Ipv4InterfaceContainer link = ipHelper.Assign(devices);
+            region.nodeGateways.push_back(link.GetAddress(0));
+            region.nodeAddresses.push_back(link.GetAddress(1));
+        }
+        region.nodeAddressStride = 4;
+    }
+    return topo;
+}
+
+/**
+ * Cambia la tasa de todos los enlaces 'bottleneck' de una topología ya construida (modo
+ * --snapshot). Los punto a punto la leen de su atributo DataRate en cada transmisión, pero un
+ * CsmaNetDevice copia la del canal al conectarse a él, así que se desconecta del canal y se
+ * vuelve a conectar.
+ *
+ * Es seguro porque se llama en el punto de la instantánea, antes de arrancar el tráfico y con
+ * el canal libre: ninguna trama está en vuelo, así que ni el canal ni el dispositivo tienen
+ * transmisiones que el cambio de identificador pueda dejar a medias. Cada hijo lo hace una sola
+ * vez, de modo que el canal solo acumula un registro inactivo por dispositivo, y el aviso de
+ * enlace activo de Attach() llega a un enlace que ya lo estaba. Attach() recalcula además el
+ * InterframeGap, así que se guarda antes y se restaura después para no perder el configurado.
+ */
+inline void
+SetBottleneckRate(const BuiltTopology& topo, DataRate rate)
+{
+    for (uint32_t i = 0; i < topo.rateDevices.GetN(); ++i)
+    {
+        Ptr<NetDevice> device = topo.rateDevices.Get(i);
+        if (Ptr<CsmaNetDevice> csma = DynamicCast<CsmaNetDevice>(device))
+        {
+            Ptr<CsmaChannel> channel = DynamicCast<CsmaChannel>(csma->GetChannel());
+            NS_ABORT_MSG_IF(!channel->IsIdle(), "SetBottleneckRate: el canal CSMA tiene una transmisión en curso");
+            TimeValue interframeGap;
+            csma->GetAttribute("InterframeGap", interframeGap);
+            channel->SetAttribute("DataRate", DataRateValue(rate));
+            channel->Detach(csma);
+            csma->Attach(channel);
+            csma->SetInterframeGap(interframeGap.Get());
+        }
+        else
+        {
+            device->SetAttribute("DataRate", DataRateValue(rate));
+        }
+    }
+}
+
+} // namespace ns3
+
+#endif // TOPOLOGY_H
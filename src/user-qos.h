@@ -0,0 +1,241 @@
+#ifndef USER_QOS_H
+#define USER_QOS_H
+
+#include "qos-stats.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+namespace ns3
+{
+
+/**
+ * Histograma logarítmico-lineal de latencias de memoria fija (al estilo de HdrHistogram).
+ *
+ * Los valores se guardan en microsegundos: hasta 32 µs cada valor tiene su propia casilla y
+ * a partir de ahí cada potencia de dos se divide en 32 casillas iguales, de modo que el error
+ * relativo de un percentil es como mucho del 3%. Cubre hasta 2^30 µs (unos 18 minutos) con
+ * 864 contadores de 32 bits, unos 3.4 KB por histograma sea cual sea el número de paquetes.
+ * Dos histogramas se combinan sumando sus contadores.
+ */
+class LatencySketch
+{
+  public:
+    static const uint32_t SUB_BITS = 5;
+    static const uint32_t SUB_BUCKETS = 1u << SUB_BITS;
+    static const uint32_t OCTAVES = 30 - SUB_BITS + 1;
+    static const uint32_t BINS = SUB_BUCKETS + OCTAVES * SUB_BUCKETS;
+
+    void Add(uint64_t us, uint32_t count = 1)
+    {
+        m_counts[Index(us)] += count;
+        m_total += count;
+    }
+
+    void AddMs(double ms, uint32_t count = 1)
+    {
+        Add(static_cast<uint64_t>(std::max(0.0, ms) * 1000 + 0.5), count);
+    }
+
+    void Merge(const LatencySketch& other)
+    {
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            m_counts[i] += other.m_counts[i];
+        }
+        m_total += other.m_total;
+    }
+
+    // Quita los valores de 'other', que debe ser un estado anterior de este mismo histograma
+    void Subtract(const LatencySketch& other)
+    {
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            m_counts[i] -= std::min(m_counts[i], other.m_counts[i]);
+        }
+        Recount();
+    }
+
+    uint64_t Count() const
+    {
+        return m_total;
+    }
+
+    // Percentil q (0..1) en ms: el centro de la casilla que lo contiene (0 si está vacío)
+    double QuantileMs(double q) const
+    {
+        if (m_total == 0)
+        {
+            return 0;
+        }
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * m_total)));
+        uint64_t seen = 0;
+        for (uint32_t i = 0; i < BINS; ++i)
+        {
+            seen += m_counts[i];
+            if (seen >= rank)
+            {
+                return (Lower(i) + Width(i) / 2.0) / 1000;
+            }
+        }
+        return Lower(BINS - 1) / 1000.0;
+    }
+
+    // Contadores en bruto, para sumarlos entre procesos MPI
+    uint32_t* Data()
+    {
+        return m_counts.data();
+    }
+
+    // Recalcula el total tras modificar los contadores con Data()
+    void Recount()
+    {
+        m_total = 0;
+        for (uint32_t c : m_counts)
+        {
+            m_total += c;
+        }
+    }
+
+  private:
+    static uint32_t Index(uint64_t us)
+    {
+        if (us < SUB_BUCKETS)
+        {
+            return us;
+        }
+        uint32_t e = 63 - __builtin_clzll(us); // us está en [2^e, 2^(e+1))
+        uint32_t sub = (us >> (e - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return std::min(BINS - 1, SUB_BUCKETS + (e - SUB_BITS) * SUB_BUCKETS + sub);
+    }
+
+    static uint64_t Lower(uint32_t i)
+    {
+        if (i < SUB_BUCKETS)
+        {
+            return i;
+        }
+        uint32_t shift = (i - SUB_BUCKETS) / SUB_BUCKETS;
+        return static_cast<uint64_t>(SUB_BUCKETS + (i - SUB_BUCKETS) % SUB_BUCKETS) << shift;
+    }
+
+    static uint64_t Width(uint32_t i)
+    {
+        return i < SUB_BUCKETS ? 1 : uint64_t(1) << ((i - SUB_BUCKETS) / SUB_BUCKETS);
+    }
+
+    std::array<uint32_t, BINS> m_counts{};
+    uint64_t m_total = 0;
+};
+
+// Contadores acumulados de un flujo, tal como los dan FlowMonitor o QosProbe
+struct FlowCounters
+{
+    uint64_t txPackets = 0;
+    uint64_t rxPackets = 0;
+    double delaySumS = 0;
+    double jitterSumS = 0;
+};
+
+// Distribución de la QoS entre los usuarios de una réplica
+struct UserQosStats
+{
+    double usersDelayOk = 0; // Fracción de usuarios con retardo medio <= MAX_DELAY_MS
+    double usersJitterOk = 0;
+    double usersLossOk = 0;
+    double usersOk = 0;     // Fracción de usuarios que cumple los tres umbrales
+    double delayP50Ms = 0;  // Percentiles del retardo de los paquetes de todos los usuarios
+    double delayP95Ms = 0;
+    double delayP99Ms = 0;
+    double jitterP95Ms = 0; // Percentil 95 de la variación de retardo entre paquetes consecutivos
+};
+
+/**
+ * Acumula los flujos servidor -> usuario (uno por usuario) de una réplica.
+ *
+ * A diferencia de las métricas medias, aquí cuentan todos los usuarios que han recibido
+ * tráfico, también los de 10 paquetes o menos: un usuario al que no le llega ningún paquete
+ * no cumple ni el retardo ni el jitter. Las pérdidas de cada usuario son (enviados -
+ * recibidos) / enviados.
+ */
+class UserQosSummary
+{
+  public:
+    void AddUser(uint64_t txPackets,
+                 uint64_t rxPackets,
+                 double meanDelayMs,
+                 double meanJitterMs,
+                 const LatencySketch& delay,
+                 const LatencySketch& jitter)
+    {
+        if (txPackets == 0)
+        {
+            return; // Sin sesiones en toda la réplica
+        }
+        bool delayOk = rxPackets > 0 && meanDelayMs <= MAX_DELAY_MS;
+        bool jitterOk = rxPackets > 1 && meanJitterMs <= MAX_JITTER_MS;
+        double lost = txPackets > rxPackets ? txPackets - rxPackets : 0;
+        bool lossOk = lost / txPackets * 100 <= MAX_LOSS_PERCENT;
+        ++m_users;
+        m_delayOk += delayOk;
+        m_jitterOk += jitterOk;
+        m_lossOk += lossOk;
+        m_ok += delayOk && jitterOk && lossOk;
+        m_delay.Merge(delay);
+        m_jitter.Merge(jitter);
+    }
+
+    // El mismo usuario a partir de los contadores acumulados de su flujo de bajada, sin los que
+    // ya tenía en 'before' (con --warmup, los del final del transitorio)
+    void AddUser(const FlowCounters& now,
+                 const FlowCounters& before,
+                 const LatencySketch& delay,
+                 const LatencySketch& jitter)
+    {
+        uint64_t tx = now.txPackets - std::min(now.txPackets, before.txPackets);
+        uint64_t rx = now.rxPackets - std::min(now.rxPackets, before.rxPackets);
+        double meanDelayMs = rx > 0 ? (now.delaySumS - before.delaySumS) / rx * 1000 : 0;
+        double meanJitterMs = rx > 1 ? (now.jitterSumS - before.jitterSumS) / (rx - 1) * 1000 : 0;
+        AddUser(tx, rx, meanDelayMs, meanJitterMs, delay, jitter);
+    }
+
+    // Quita de los percentiles los paquetes de todos los usuarios recogidos en 'delay' y
+    // 'jitter' (con --warmup, los histogramas al final del transitorio)
+    void RemovePackets(const LatencySketch& delay, const LatencySketch& jitter)
+    {
+        m_delay.Subtract(delay);
+        m_jitter.Subtract(jitter);
+    }
+
+    UserQosStats Result() const
+    {
+        UserQosStats s;
+        if (m_users > 0)
+        {
+            s.usersDelayOk = double(m_delayOk) / m_users;
+            s.usersJitterOk = double(m_jitterOk) / m_users;
+            s.usersLossOk = double(m_lossOk) / m_users;
+            s.usersOk = double(m_ok) / m_users;
+        }
+        s.delayP50Ms = m_delay.QuantileMs(0.50);
+        s.delayP95Ms = m_delay.QuantileMs(0.95);
+        s.delayP99Ms = m_delay.QuantileMs(0.99);
+        s.jitterP95Ms = m_jitter.QuantileMs(0.95);
+        return s;
+    }
+
+  private:
+    uint32_t m_users = 0;
+    uint32_t m_delayOk = 0;
+    uint32_t m_jitterOk = 0;
+    uint32_t m_lossOk = 0;
+    uint32_t m_ok = 0;
+    LatencySketch m_delay;
+    LatencySketch m_jitter;
+};
+
+} // namespace ns3
+
+#endif // USER_QOS_H